@@ -0,0 +1,98 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+
+#include "benchmark.hpp"
+#include "allocator.hpp"
+#include "buffer.hpp"
+
+static const size_t BENCHMARK_ITERATIONS = 20000;
+
+// a typical small message: a header, a handful of fields and strings
+static void encode_message(Buffer *buffer)
+{
+  buffer->write_uint32(0xdeadbeef);
+  buffer->write_uint16(1);
+  buffer->write_uint64(1234567890123ull);
+
+  for (uint32_t i = 0; i < 32; i++)
+  {
+    buffer->write_uint32(i);
+    buffer->write_float64(i * 0.5);
+    buffer->write_string("subscriber.event.name");
+  }
+
+  buffer->write_padded_string("trailer", 16);
+}
+
+// builds several independent buffers per request, as an encoder building
+// sub-messages would, then releases them all at the end of the request
+static void encode_request(BufferAllocator *allocator)
+{
+  Buffer *buffers[16];
+  for (size_t i = 0; i < 16; i++)
+  {
+    buffers[i] = new Buffer(allocator);
+    encode_message(buffers[i]);
+    do_not_optimize(buffers[i]->get_data());
+  }
+
+  for (size_t i = 0; i < 16; i++)
+  {
+    delete buffers[i];
+  }
+}
+
+int main(int argc, char **argv)
+{
+  BufferAllocator *heap_allocator = BufferAllocator::get_default();
+  double heap_ns = run_benchmark("encode_request/heap", BENCHMARK_ITERATIONS, [&]()
+  {
+    encode_request(heap_allocator);
+  });
+
+  ArenaAllocator arena_allocator;
+  double arena_ns = run_benchmark("encode_request/arena", BENCHMARK_ITERATIONS, [&]()
+  {
+    encode_request(&arena_allocator);
+    arena_allocator.reset();
+  });
+
+  PoolAllocator pool_allocator;
+  double pool_ns = run_benchmark("encode_request/pool", BENCHMARK_ITERATIONS, [&]()
+  {
+    encode_request(&pool_allocator);
+  });
+
+  std::cout << std::endl;
+  std::cout << "arena speedup over heap: " << heap_ns / arena_ns << "x" << std::endl;
+  std::cout << "pool speedup over heap: " << heap_ns / pool_ns << "x" << std::endl;
+  return 0;
+}
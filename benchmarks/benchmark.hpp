@@ -0,0 +1,69 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <cstdlib>
+#include <cstdint>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+// keeps the compiler from optimizing away a value the benchmark computed
+template <typename Type>
+inline void do_not_optimize(const Type &value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// runs the function for the given number of iterations and
+// prints the average wall clock time of a single iteration
+template <typename Function>
+inline double run_benchmark(const std::string &name, size_t iterations, Function function)
+{
+  // warm up the caches and the allocator before measuring
+  function();
+
+  auto begin = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++)
+  {
+    function();
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  double total_ns = std::chrono::duration<double, std::nano>(end - begin).count();
+  double iteration_ns = total_ns / iterations;
+
+  std::cout << std::left << std::setw(40) << name
+            << std::right << std::setw(14) << std::fixed << std::setprecision(1)
+            << iteration_ns << " ns/iter" << std::endl;
+
+  return iteration_ns;
+}
+
+#endif // _BENCHMARK_H
@@ -0,0 +1,88 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "lexer.hpp"
+
+static const size_t BENCHMARK_ITERATIONS = 50;
+static const size_t BENCHMARK_LINE_COUNT = 100000;
+
+static double run_tokenize_benchmark(const std::string &name, const std::string &source)
+{
+  std::vector<LexerTokenRecord> records;
+  double tokenize_ns = run_benchmark(name, BENCHMARK_ITERATIONS, [&]()
+  {
+    records.clear();
+    Lexer lexer(source.c_str(), source.size());
+    lexer.tokenize(records);
+    do_not_optimize(records.data());
+  });
+
+  return source.size() / tokenize_ns;
+}
+
+int main(int argc, char **argv)
+{
+  // long identifiers separated by runs of indentation
+  std::string names;
+  for (size_t i = 0; i < BENCHMARK_LINE_COUNT; i++)
+  {
+    names += "        serialbuf_long_identifier_name_";
+    names += (char)('a' + i % 26);
+    names += " = Another_Long_Identifier_Name\n";
+  }
+
+  // a numeric column of long fractions
+  std::string numbers;
+  for (size_t i = 0; i < BENCHMARK_LINE_COUNT; i++)
+  {
+    numbers += "    " + std::to_string(i * 2654435761u) + ".0123456789012345\n";
+  }
+
+  // long string literals, most without escapes
+  std::string strings;
+  for (size_t i = 0; i < BENCHMARK_LINE_COUNT; i++)
+  {
+    strings += "    \"a long string literal without any escapes in it, ";
+    strings += i % 16 == 0 ? "but this one has \\\"one\\\"\"\n" : "as most of them do\"\n";
+  }
+
+  double names_gbs = run_tokenize_benchmark("tokenize/names", names);
+  double numbers_gbs = run_tokenize_benchmark("tokenize/numbers", numbers);
+  double strings_gbs = run_tokenize_benchmark("tokenize/strings", strings);
+
+  std::cout << std::endl;
+  std::cout << "tokenize names: " << names_gbs << " GB/s" << std::endl;
+  std::cout << "tokenize numbers: " << numbers_gbs << " GB/s" << std::endl;
+  std::cout << "tokenize strings: " << strings_gbs << " GB/s" << std::endl;
+  return 0;
+}
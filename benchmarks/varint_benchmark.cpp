@@ -0,0 +1,106 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "varint.hpp"
+#include "buffer.hpp"
+
+static const size_t BENCHMARK_ITERATIONS = 200;
+static const size_t BENCHMARK_VALUE_COUNT = 1000000;
+
+int main(int argc, char **argv)
+{
+  // mostly small counters and ids with the occasional large value
+  std::vector<uint32_t> values(BENCHMARK_VALUE_COUNT);
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    values[i] = (i % 16 == 0) ? (uint32_t)(i * 2654435761u) : (uint32_t)(i % 1000);
+  }
+
+  Buffer fixed_buffer;
+  for (uint32_t value : values)
+  {
+    fixed_buffer.write_uint32(value);
+  }
+
+  Buffer varint_buffer;
+  for (uint32_t value : values)
+  {
+    varint_buffer.write_varuint32(value);
+  }
+
+  Buffer stream_vbyte_buffer;
+  stream_vbyte_buffer.write_varuint32_array(values.data(), values.size());
+
+  std::cout << "fixed size: " << fixed_buffer.get_size() << " bytes" << std::endl;
+  std::cout << "varint size: " << varint_buffer.get_size() << " bytes" << std::endl;
+  std::cout << "stream vbyte size: " << stream_vbyte_buffer.get_size() << " bytes" << std::endl;
+  std::cout << std::endl;
+
+  std::vector<uint32_t> decoded_values(values.size());
+  double fixed_ns = run_benchmark("decode/read_uint32", BENCHMARK_ITERATIONS, [&]()
+  {
+    BufferIterator buffer_iterator(&fixed_buffer);
+    for (size_t i = 0; i < decoded_values.size(); i++)
+    {
+      decoded_values[i] = buffer_iterator.read_uint32();
+    }
+
+    do_not_optimize(decoded_values.data());
+  });
+
+  double varint_ns = run_benchmark("decode/read_varuint32", BENCHMARK_ITERATIONS, [&]()
+  {
+    BufferIterator buffer_iterator(&varint_buffer);
+    for (size_t i = 0; i < decoded_values.size(); i++)
+    {
+      decoded_values[i] = buffer_iterator.read_varuint32();
+    }
+
+    do_not_optimize(decoded_values.data());
+  });
+
+  double stream_vbyte_ns = run_benchmark("decode/read_varuint32_array", BENCHMARK_ITERATIONS, [&]()
+  {
+    BufferIterator buffer_iterator(&stream_vbyte_buffer);
+    buffer_iterator.read_varuint32_array(decoded_values.data(), decoded_values.size());
+    do_not_optimize(decoded_values.data());
+  });
+
+  // throughput in decoded bytes, four per value
+  double decoded_size = values.size() * sizeof(uint32_t);
+  std::cout << std::endl;
+  std::cout << "read_uint32: " << decoded_size / fixed_ns << " GB/s" << std::endl;
+  std::cout << "read_varuint32: " << decoded_size / varint_ns << " GB/s" << std::endl;
+  std::cout << "read_varuint32_array: " << decoded_size / stream_vbyte_ns << " GB/s" << std::endl;
+  return 0;
+}
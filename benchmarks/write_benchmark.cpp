@@ -0,0 +1,91 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "buffer.hpp"
+
+static const size_t BENCHMARK_ITERATIONS = 200;
+static const size_t BENCHMARK_VALUE_COUNT = 1000000;
+
+int main(int argc, char **argv)
+{
+  std::vector<uint32_t> values(BENCHMARK_VALUE_COUNT);
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    values[i] = (uint32_t)(i * 2654435761u);
+  }
+
+  // the buffer keeps its capacity between iterations, so only
+  // the per value overhead of the write path is measured
+  Buffer buffer;
+  double write_ns = run_benchmark("encode/write_uint32", BENCHMARK_ITERATIONS, [&]()
+  {
+    buffer.set_offset(0);
+    for (uint32_t value : values)
+    {
+      buffer.write_uint32(value);
+    }
+
+    do_not_optimize(buffer.get_data());
+  });
+
+  double write_fixed_ns = run_benchmark("encode/write_uint32+write_float64", BENCHMARK_ITERATIONS, [&]()
+  {
+    buffer.set_offset(0);
+    for (uint32_t value : values)
+    {
+      buffer.write_uint32(value);
+      buffer.write_float64((double)value);
+    }
+
+    do_not_optimize(buffer.get_data());
+  });
+
+  std::vector<uint32_t> decoded_values(values.size());
+  double read_ns = run_benchmark("decode/read_uint32", BENCHMARK_ITERATIONS, [&]()
+  {
+    BufferIterator buffer_iterator(&buffer);
+    for (size_t i = 0; i < decoded_values.size(); i++)
+    {
+      decoded_values[i] = buffer_iterator.read_uint32();
+    }
+
+    do_not_optimize(decoded_values.data());
+  });
+
+  double encoded_size = values.size() * sizeof(uint32_t);
+  std::cout << std::endl;
+  std::cout << "write_uint32: " << encoded_size / write_ns << " GB/s" << std::endl;
+  std::cout << "write_uint32+write_float64: " << encoded_size * 3 / write_fixed_ns << " GB/s" << std::endl;
+  std::cout << "read_uint32: " << encoded_size / read_ns << " GB/s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,308 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <algorithm>
+
+#include "allocator.hpp"
+
+// every arena allocation is aligned so that any fixed width value
+// written into the buffer can be loaded without crossing the alignment
+static const size_t ARENA_ALIGNMENT = 16;
+static const size_t ARENA_DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+// the size of each chunk of memory the pool carves its size classes from
+static const size_t POOL_SLAB_SIZE = 64 * 1024;
+
+static inline size_t align_arena_size(size_t size)
+{
+  return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+BufferAllocator::~BufferAllocator()
+{
+
+}
+
+BufferAllocator* BufferAllocator::get_default()
+{
+  // intentionally never destroyed, buffers with static storage duration
+  // may still release their memory after static destructors have run
+  static HeapAllocator *allocator = new HeapAllocator();
+  return allocator;
+}
+
+uint8_t* HeapAllocator::allocate(size_t size)
+{
+  return (uint8_t*)malloc(size);
+}
+
+uint8_t* HeapAllocator::reallocate(uint8_t *data, size_t size, size_t new_size)
+{
+  return (uint8_t*)realloc(data, new_size);
+}
+
+void HeapAllocator::deallocate(uint8_t *data, size_t size)
+{
+  free(data);
+}
+
+ArenaAllocator::ArenaAllocator(size_t block_size) : block_size_(block_size)
+{
+  assert(block_size > 0);
+}
+
+ArenaAllocator::ArenaAllocator() : ArenaAllocator(ARENA_DEFAULT_BLOCK_SIZE)
+{
+
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+  for (ArenaBlock &block : blocks_)
+  {
+    free(block.data);
+  }
+
+  blocks_.clear();
+}
+
+uint8_t* ArenaAllocator::allocate(size_t size)
+{
+  size_t aligned_size = align_arena_size(size);
+  if (blocks_.empty() || current_offset_ + aligned_size > blocks_[current_block_].size)
+  {
+    // reuse the following block if a previous reset left one large enough,
+    // otherwise insert a new block right after the current one
+    size_t next_block = blocks_.empty() ? 0 : current_block_ + 1;
+    if (next_block >= blocks_.size() || blocks_[next_block].size < aligned_size)
+    {
+      size_t block_size = std::max(block_size_, aligned_size);
+      uint8_t *block_data = (uint8_t*)malloc(block_size);
+      if (block_data == nullptr)
+      {
+        return nullptr;
+      }
+
+      blocks_.insert(blocks_.begin() + next_block, ArenaBlock { block_data, block_size });
+    }
+
+    current_block_ = next_block;
+    current_offset_ = 0;
+  }
+
+  uint8_t *data = blocks_[current_block_].data + current_offset_;
+  current_offset_ += aligned_size;
+  used_size_ += aligned_size;
+  return data;
+}
+
+uint8_t* ArenaAllocator::reallocate(uint8_t *data, size_t size, size_t new_size)
+{
+  if (data == nullptr)
+  {
+    return allocate(new_size);
+  }
+
+  // the most recent allocation can be resized in place
+  if (is_last_allocation(data, size))
+  {
+    const ArenaBlock &block = blocks_[current_block_];
+    size_t begin_offset = data - block.data;
+    size_t aligned_size = align_arena_size(new_size);
+    if (begin_offset + aligned_size <= block.size)
+    {
+      used_size_ = used_size_ - align_arena_size(size) + aligned_size;
+      current_offset_ = begin_offset + aligned_size;
+      return data;
+    }
+  }
+
+  uint8_t *new_data = allocate(new_size);
+  if (new_data == nullptr)
+  {
+    return nullptr;
+  }
+
+  memcpy(new_data, data, std::min(size, new_size));
+  return new_data;
+}
+
+void ArenaAllocator::deallocate(uint8_t *data, size_t size)
+{
+  // only the most recent allocation can be handed back,
+  // everything else is released when the arena is reset
+  if (data != nullptr && is_last_allocation(data, size))
+  {
+    size_t aligned_size = align_arena_size(size);
+    current_offset_ -= aligned_size;
+    used_size_ -= aligned_size;
+  }
+}
+
+void ArenaAllocator::reset()
+{
+  current_block_ = 0;
+  current_offset_ = 0;
+  used_size_ = 0;
+}
+
+size_t ArenaAllocator::get_block_size() const
+{
+  return block_size_;
+}
+
+size_t ArenaAllocator::get_block_count() const
+{
+  return blocks_.size();
+}
+
+size_t ArenaAllocator::get_used_size() const
+{
+  return used_size_;
+}
+
+bool ArenaAllocator::is_last_allocation(const uint8_t *data, size_t size) const
+{
+  if (blocks_.empty())
+  {
+    return false;
+  }
+
+  const ArenaBlock &block = blocks_[current_block_];
+  return data + align_arena_size(size) == block.data + current_offset_;
+}
+
+PoolAllocator::PoolAllocator()
+{
+
+}
+
+PoolAllocator::~PoolAllocator()
+{
+  release();
+}
+
+uint8_t* PoolAllocator::allocate(size_t size)
+{
+  size_t size_class = get_size_class(size);
+  if (size_class >= POOL_NUM_CLASSES)
+  {
+    return (uint8_t*)malloc(size);
+  }
+
+  PoolEntry *entry = free_lists_[size_class];
+  if (entry == nullptr)
+  {
+    // carve a new slab into entries of this size class
+    size_t class_size = (size_t)1 << (size_class + POOL_MIN_CLASS_SHIFT);
+    size_t slab_size = std::max(POOL_SLAB_SIZE, class_size);
+    uint8_t *slab = (uint8_t*)malloc(slab_size);
+    if (slab == nullptr)
+    {
+      return nullptr;
+    }
+
+    slabs_.push_back(slab);
+    for (size_t offset = slab_size; offset >= class_size; offset -= class_size)
+    {
+      PoolEntry *slab_entry = (PoolEntry*)(slab + offset - class_size);
+      slab_entry->next = entry;
+      entry = slab_entry;
+    }
+  }
+
+  free_lists_[size_class] = entry->next;
+  return (uint8_t*)entry;
+}
+
+uint8_t* PoolAllocator::reallocate(uint8_t *data, size_t size, size_t new_size)
+{
+  if (data == nullptr)
+  {
+    return allocate(new_size);
+  }
+
+  size_t size_class = get_size_class(size);
+  size_t new_size_class = get_size_class(new_size);
+  if (size_class >= POOL_NUM_CLASSES && new_size_class >= POOL_NUM_CLASSES)
+  {
+    return (uint8_t*)realloc(data, new_size);
+  }
+  else if (size_class == new_size_class)
+  {
+    return data;
+  }
+
+  uint8_t *new_data = allocate(new_size);
+  if (new_data == nullptr)
+  {
+    return nullptr;
+  }
+
+  memcpy(new_data, data, std::min(size, new_size));
+  deallocate(data, size);
+  return new_data;
+}
+
+void PoolAllocator::deallocate(uint8_t *data, size_t size)
+{
+  if (data == nullptr)
+  {
+    return;
+  }
+
+  size_t size_class = get_size_class(size);
+  if (size_class >= POOL_NUM_CLASSES)
+  {
+    free(data);
+    return;
+  }
+
+  PoolEntry *entry = (PoolEntry*)data;
+  entry->next = free_lists_[size_class];
+  free_lists_[size_class] = entry;
+}
+
+void PoolAllocator::release()
+{
+  for (uint8_t *slab : slabs_)
+  {
+    free(slab);
+  }
+
+  slabs_.clear();
+  memset(free_lists_, 0, sizeof(free_lists_));
+}
+
+size_t PoolAllocator::get_size_class(size_t size)
+{
+  if (size <= ((size_t)1 << POOL_MIN_CLASS_SHIFT))
+  {
+    return 0;
+  }
+
+  size_t shift = 64 - __builtin_clzll((unsigned long long)(size - 1));
+  return shift - POOL_MIN_CLASS_SHIFT;
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _BUFFER_ALLOCATOR_H
+#define _BUFFER_ALLOCATOR_H
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#include <vector>
+
+// the storage hook used by Buffer, every allocation a buffer makes goes
+// through its allocator. allocators return nullptr when they run out of
+// memory and are not safe to share between threads unless stated otherwise
+class BufferAllocator
+{
+public:
+  virtual ~BufferAllocator();
+
+  virtual uint8_t* allocate(size_t size) = 0;
+  virtual uint8_t* reallocate(uint8_t *data, size_t size, size_t new_size) = 0;
+  virtual void deallocate(uint8_t *data, size_t size) = 0;
+
+  static BufferAllocator* get_default();
+};
+
+// the default allocator, backed by malloc, realloc and free, it is
+// stateless and safe to share between threads
+class HeapAllocator : public BufferAllocator
+{
+public:
+  uint8_t* allocate(size_t size);
+  uint8_t* reallocate(uint8_t *data, size_t size, size_t new_size);
+  void deallocate(uint8_t *data, size_t size);
+};
+
+// a bump pointer allocator, allocations are carved out of large blocks
+// and are only released all at once by reset(). the most recent allocation
+// can be grown or released in place, which suits a single buffer being
+// written to while it lives in the arena
+class ArenaAllocator : public BufferAllocator
+{
+public:
+  ArenaAllocator(size_t block_size);
+  ArenaAllocator();
+  ~ArenaAllocator();
+
+  uint8_t* allocate(size_t size);
+  uint8_t* reallocate(uint8_t *data, size_t size, size_t new_size);
+  void deallocate(uint8_t *data, size_t size);
+
+  void reset();
+
+  size_t get_block_size() const;
+  size_t get_block_count() const;
+  size_t get_used_size() const;
+
+private:
+  struct ArenaBlock
+  {
+    uint8_t *data;
+    size_t size;
+  };
+
+  bool is_last_allocation(const uint8_t *data, size_t size) const;
+
+  std::vector<ArenaBlock> blocks_;
+  size_t block_size_ = 0;
+  size_t current_block_ = 0;
+  size_t current_offset_ = 0;
+  size_t used_size_ = 0;
+};
+
+// a size class allocator, allocations are rounded up to a power of two
+// and recycled through a free list per size class. allocations larger
+// than the biggest size class fall through to the heap
+class PoolAllocator : public BufferAllocator
+{
+public:
+  PoolAllocator();
+  ~PoolAllocator();
+
+  uint8_t* allocate(size_t size);
+  uint8_t* reallocate(uint8_t *data, size_t size, size_t new_size);
+  void deallocate(uint8_t *data, size_t size);
+
+  void release();
+
+  static size_t get_size_class(size_t size);
+
+private:
+  struct PoolEntry
+  {
+    PoolEntry *next;
+  };
+
+  static const size_t POOL_MIN_CLASS_SHIFT = 4;
+  static const size_t POOL_MAX_CLASS_SHIFT = 16;
+  static const size_t POOL_NUM_CLASSES = POOL_MAX_CLASS_SHIFT - POOL_MIN_CLASS_SHIFT + 1;
+
+  PoolEntry *free_lists_[POOL_NUM_CLASSES] = {};
+  std::vector<uint8_t*> slabs_;
+};
+
+#endif // _BUFFER_ALLOCATOR_H
@@ -27,7 +27,11 @@
 
 #include "buffer.hpp"
 
-Buffer::Buffer(const uint8_t *data, size_t size, size_t offset) : size_(size), offset_(offset)
+// the smallest allocation made when a buffer first grows, this avoids
+// several tiny reallocations for the first few writes
+static const size_t BUFFER_MIN_CAPACITY = 64;
+
+Buffer::Buffer(const uint8_t *data, size_t size, size_t offset)
 {
   if (size > 0)
   {
@@ -40,6 +44,8 @@ Buffer::Buffer(const uint8_t *data, size_t size, size_t offset) : size_(size), o
       pad(size);
     }
   }
+
+  offset_ = offset;
 }
 
 Buffer::Buffer(const uint8_t *data, size_t size) : Buffer(data, size, 0)
@@ -47,6 +53,23 @@ Buffer::Buffer(const uint8_t *data, size_t size) : Buffer(data, size, 0)
 
 }
 
+Buffer::Buffer(uint8_t *data, size_t size, size_t capacity, BufferAllocator *allocator)
+  : data_(data), size_(size), capacity_(capacity), allocator_(allocator)
+{
+  assert(size <= capacity);
+  assert(allocator != nullptr);
+}
+
+Buffer::Buffer(Buffer &&other) : Buffer()
+{
+  *this = std::move(other);
+}
+
+Buffer::Buffer(BufferAllocator *allocator) : Buffer()
+{
+  set_allocator(allocator);
+}
+
 Buffer::Buffer() : Buffer(nullptr, 0, 0)
 {
 
@@ -57,16 +80,97 @@ Buffer::~Buffer()
   clear();
 }
 
+Buffer& Buffer::operator = (Buffer &&other)
+{
+  if (this != &other)
+  {
+    clear();
+    if (other.has_external_storage())
+    {
+      // the other buffer's storage stays with it, so its
+      // bytes are copied out rather than pointed at
+      allocator_ = other.allocator_;
+      other.copy(this);
+      other.size_ = 0;
+      other.offset_ = 0;
+      other.invalidate_marks();
+    }
+    else
+    {
+      swap(other);
+    }
+  }
+
+  return *this;
+}
+
 void Buffer::clear()
 {
   if (data_ != nullptr)
   {
-    free(data_);
+    if (owns_data_)
+    {
+      allocator_->deallocate(data_, capacity_);
+    }
+
     data_ = nullptr;
   }
 
   size_ = 0;
   offset_ = 0;
+  capacity_ = 0;
+  owns_data_ = true;
+  invalidate_marks();
+}
+
+void Buffer::swap(Buffer &other)
+{
+  if (has_external_storage() || other.has_external_storage())
+  {
+    throw std::runtime_error("Cannot swap a Buffer that writes into storage it does not own!");
+  }
+
+  std::swap(data_, other.data_);
+  std::swap(size_, other.size_);
+  std::swap(offset_, other.offset_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(allocator_, other.allocator_);
+  std::swap(owns_data_, other.owns_data_);
+  invalidate_marks();
+  other.invalidate_marks();
+}
+
+uint8_t* Buffer::release()
+{
+  if (!owns_data_)
+  {
+    throw std::runtime_error("Cannot release the data of a Buffer that borrows it!");
+  }
+
+  // the caller now owns the data and must hand it back
+  // to this buffer's allocator along with its capacity
+  uint8_t *data = data_;
+  data_ = nullptr;
+  size_ = 0;
+  offset_ = 0;
+  capacity_ = 0;
+  return data;
+}
+
+void Buffer::set_allocator(BufferAllocator *allocator)
+{
+  assert(allocator != nullptr);
+  if (data_ != nullptr && owns_data_)
+  {
+    throw std::runtime_error("Cannot change the allocator of a Buffer that holds data!");
+  }
+
+  allocator_ = allocator;
+}
+
+BufferAllocator* Buffer::get_allocator() const
+{
+  return allocator_;
 }
 
 void Buffer::set_data(const uint8_t *data, size_t size)
@@ -78,7 +182,7 @@ void Buffer::set_data(const uint8_t *data, size_t size)
   clear();
 
   // copy the new data
-  data_ = (uint8_t*)calloc(size, 1);
+  data_ = allocator_->allocate(size);
   if (!data_)
   {
     throw std::runtime_error(StringFormatter() << "Failed to set buffer data with size: " << size);
@@ -86,21 +190,32 @@ void Buffer::set_data(const uint8_t *data, size_t size)
 
   memcpy(data_, data, size);
   size_ = size;
+  capacity_ = size;
 }
 
-const uint8_t* Buffer::get_data() const
+void Buffer::set_borrowed_data(const uint8_t *data, size_t size)
 {
-  return data_;
+  assert(data != nullptr || size == 0);
+
+  // clear our current data
+  clear();
+
+  // point at the caller's memory without copying it, the memory is never
+  // written to and must outlive the buffer. a zero capacity sends the first
+  // write through reserve(), which moves the data into storage of our own
+  data_ = (uint8_t*)data;
+  size_ = size;
+  owns_data_ = false;
 }
 
-void Buffer::set_size(size_t size)
+bool Buffer::is_borrowed() const
 {
-  size_ = size;
+  return !owns_data_;
 }
 
-size_t Buffer::get_size() const
+void Buffer::set_size(size_t size)
 {
-  return size_;
+  size_ = size;
 }
 
 void Buffer::set_offset(size_t offset)
@@ -113,17 +228,30 @@ size_t Buffer::get_offset() const
   return offset_;
 }
 
+size_t Buffer::get_capacity() const
+{
+  return capacity_;
+}
+
 void Buffer::copy(Buffer *other_buffer)
 {
   assert(other_buffer != nullptr);
+  if (other_buffer == this)
+  {
+    return;
+  }
 
-  // prepare the other buffer for copying
-  other_buffer->clear();
-  other_buffer->resize(size_);
+  // reuse the other buffer's storage when it is already large enough
+  other_buffer->size_ = 0;
+  other_buffer->offset_ = 0;
+  if (size_ > 0)
+  {
+    other_buffer->reserve(size_);
+    memcpy(other_buffer->data_, data_, size_);
+  }
 
-  // copy our contents to the other buffer
-  other_buffer->set_data(data_, size_);
-  other_buffer->set_offset(offset_);
+  other_buffer->size_ = size_;
+  other_buffer->offset_ = offset_;
 }
 
 bool Buffer::compare(const Buffer *other_buffer) const
@@ -135,23 +263,89 @@ bool Buffer::compare(const Buffer *other_buffer) const
     offset_ == other_buffer->get_offset());
 }
 
-void Buffer::resize(size_t size)
+void Buffer::reserve(size_t capacity)
 {
-  assert(size > 0);
-  size_t current_size = size_ - offset_;
-  if (current_size >= size)
+  if (capacity <= capacity_)
+  {
+    return;
+  }
+
+  if (!owns_data_)
+  {
+    if (capacity < size_)
+    {
+      capacity = size_;
+    }
+
+    uint8_t *data = allocator_->allocate(capacity);
+    if (data == nullptr)
+    {
+      throw std::runtime_error(StringFormatter() << "Failed to reserve buffer data with capacity: " << capacity);
+    }
+
+    if (size_ > 0)
+    {
+      memcpy(data, data_, size_);
+    }
+
+    data_ = data;
+    capacity_ = capacity;
+    owns_data_ = true;
+    return;
+  }
+
+  uint8_t *data = allocator_->reallocate(data_, capacity_, capacity);
+  if (data == nullptr)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to reserve buffer data with capacity: " << capacity);
+  }
+
+  data_ = data;
+  capacity_ = capacity;
+}
+
+void Buffer::shrink_to_fit()
+{
+  if (!owns_data_ || capacity_ == size_)
   {
     return;
   }
 
-  data_ = (uint8_t*)realloc(data_, size_ + size);
-  if (data_ == nullptr)
+  if (size_ == 0)
   {
-    throw std::runtime_error(StringFormatter() << "Failed to resize buffer data with size: " << size);
+    allocator_->deallocate(data_, capacity_);
+    data_ = nullptr;
+    capacity_ = 0;
+    return;
   }
 
-  memset(data_ + offset_, 0, size);
-  size_ += size;
+  uint8_t *data = allocator_->reallocate(data_, capacity_, size_);
+  if (data == nullptr)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to shrink buffer data with size: " << size_);
+  }
+
+  data_ = data;
+  capacity_ = size_;
+}
+
+void Buffer::grow(size_t size)
+{
+  // grow geometrically so that a long run of small writes
+  // only reallocates a logarithmic number of times
+  size_t required_capacity = offset_ + size;
+  size_t capacity = capacity_ * 2;
+  if (capacity < BUFFER_MIN_CAPACITY)
+  {
+    capacity = BUFFER_MIN_CAPACITY;
+  }
+
+  if (capacity < required_capacity)
+  {
+    capacity = required_capacity;
+  }
+
+  reserve(capacity);
 }
 
 void Buffer::write(const uint8_t *data, size_t size)
@@ -167,84 +361,139 @@ void Buffer::write(const uint8_t *data, size_t size)
 void Buffer::pad(size_t size)
 {
   assert(size > 0);
-  uint8_t *data = (uint8_t*)calloc(size, 1);
-  if (data == nullptr)
+  resize(size);
+  memset(data_ + offset_, 0, size);
+  offset_ += size;
+}
+
+uint8_t* Buffer::prepare(size_t size)
+{
+  assert(size > 0);
+
+  // make room for the bytes without counting them yet, the caller fills
+  // in what it can and then commits only the bytes it actually produced
+  if (offset_ + size > capacity_)
   {
-    throw std::runtime_error(StringFormatter() << "Failed to pad bytes with size: " << size);
+    grow(size);
   }
 
-  write(data, size);
-  free(data);
+  return data_ + offset_;
 }
 
-void Buffer::write_uint8(uint8_t value)
+void Buffer::commit(size_t size)
 {
-  resize(1);
-  *(uint8_t*)(data_ + offset_) = value;
-  offset_ += 1;
-}
+  // borrowed data has no capacity, so the offset may be past it
+  size_t prepared_size = offset_ < capacity_ ? capacity_ - offset_ : 0;
+  if (size > prepared_size)
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot commit more bytes than were prepared: " << size << " bytes prepared: " << prepared_size);
+  }
 
-void Buffer::write_int8(int8_t value)
-{
-  resize(1);
-  *(int8_t*)(data_ + offset_) = value;
-  offset_ += 1;
+  offset_ += size;
+  if (offset_ > size_)
+  {
+    size_ = offset_;
+  }
 }
 
-void Buffer::write_uint16(uint16_t value)
+BufferMark Buffer::mark() const
 {
-  resize(2);
-  *(uint16_t*)(data_ + offset_) = value;
-  offset_ += 2;
+  BufferMark mark = { offset_, size_, generation_ };
+  return mark;
 }
 
-void Buffer::write_int16(int16_t value)
+void Buffer::rewind(BufferMark mark)
 {
-  resize(2);
-  *(int16_t*)(data_ + offset_) = value;
-  offset_ += 2;
-}
+  if (mark.generation != generation_)
+  {
+    throw std::runtime_error("Cannot rewind to mark, the bytes after it have left the buffer's storage!");
+  }
 
-void Buffer::write_uint32(uint32_t value)
-{
-  resize(4);
-  *(uint32_t*)(data_ + offset_) = value;
-  offset_ += 4;
+  if (mark.size > size_ || mark.offset > mark.size)
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot rewind to mark at offset: " << mark.offset << ", buffer size: " << size_);
+  }
+
+  // everything written after the mark is dropped, the storage is kept
+  offset_ = mark.offset;
+  size_ = mark.size;
 }
 
-void Buffer::write_int32(int32_t value)
+void Buffer::write_varuint32(uint32_t value)
 {
-  resize(4);
-  *(int32_t*)(data_ + offset_) = value;
-  offset_ += 4;
+  write_varuint64(value);
 }
 
-void Buffer::write_uint64(uint64_t value)
+void Buffer::write_varint32(int32_t value)
 {
-  resize(8);
-  *(uint64_t*)(data_ + offset_) = value;
-  offset_ += 8;
+  write_varuint64(zigzag_encode32(value));
 }
 
-void Buffer::write_int64(int64_t value)
+void Buffer::write_varuint64(uint64_t value)
 {
-  resize(8);
-  *(int64_t*)(data_ + offset_) = value;
-  offset_ += 8;
+  // with room for the longest encoding the size is never computed, near
+  // the end of the storage only the bytes the value takes are asked for,
+  // so a buffer reserved to an exact size never has to grow
+  if (offset_ + VARINT_MAX_SIZE64 > capacity_)
+  {
+    size_t size = get_varuint_size(value);
+    if (offset_ + size > capacity_)
+    {
+      grow(size);
+    }
+  }
+
+  offset_ += encode_varuint(data_ + offset_, value);
+  if (offset_ > size_)
+  {
+    size_ = offset_;
+  }
 }
 
-void Buffer::write_float32(float value)
+void Buffer::write_varint64(int64_t value)
 {
-  uint32_t v = 0;
-  memcpy(&v, &value, 4);
-  write_uint32(v);
+  write_varuint64(zigzag_encode64(value));
 }
 
-void Buffer::write_float64(double value)
+void Buffer::write_varuint32_array(const uint32_t *values, size_t count)
 {
-  uint64_t v = 0;
-  memcpy(&v, &value, 8);
-  write_uint64(v);
+  if (count == 0)
+  {
+    return;
+  }
+
+  size_t size = get_stream_vbyte_size(values, count);
+  if (offset_ + size <= capacity_)
+  {
+    resize(size);
+    stream_vbyte_encode(data_ + offset_, values, count);
+    offset_ += size;
+    return;
+  }
+
+  // the control bytes of every value come before any of the data bytes,
+  // so the array is encoded a group at a time twice, once for the control
+  // bytes and once for the data, and each part goes through write() which
+  // flushes a StreamWriter instead of growing it to the whole array
+  // a whole number of control bytes per group keeps the groups' control
+  // bytes identical to those of the array encoded at once
+  const size_t group_count = BUFFER_ARRAY_CHUNK_SIZE / sizeof(uint32_t);
+  static_assert(group_count % 4 == 0, "Stream VByte groups must fill their control bytes!");
+  uint8_t group[group_count / 4 + BUFFER_ARRAY_CHUNK_SIZE];
+  for (size_t i = 0; i < count; i += group_count)
+  {
+    size_t value_count = std::min(group_count, count - i);
+    stream_vbyte_encode(group, values + i, value_count);
+    write(group, get_stream_vbyte_control_size(value_count));
+  }
+
+  for (size_t i = 0; i < count; i += group_count)
+  {
+    size_t value_count = std::min(group_count, count - i);
+    size_t control_size = get_stream_vbyte_control_size(value_count);
+    size_t group_size = stream_vbyte_encode(group, values + i, value_count);
+    write(group + control_size, group_size - control_size);
+  }
 }
 
 void Buffer::write_string8(const char *string, uint8_t size)
@@ -427,286 +676,432 @@ bool BufferIterator::compare(const BufferIterator *other_buffer_iterator) const
     offset_ == other_buffer_iterator->get_offset());
 }
 
-size_t BufferIterator::get_remaining_size() const
+bool BufferIterator::fill(size_t size)
 {
-  return buffer_->get_size() - offset_;
+  // a buffer holds all of its data up front, there is nothing to refill
+  return false;
 }
 
-const uint8_t* BufferIterator::get_remaining_data() const
+uint8_t* BufferIterator::read(size_t size)
 {
-  return buffer_->get_data() + offset_;
+  assert(size > 0);
+  BufferView view = read_view(size);
+  uint8_t *data = (uint8_t*)malloc(size);
+  if (data == nullptr)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to read data from BufferIterator with size: " << size);
+  }
+
+  memcpy(data, view.get_data(), size);
+  return data;
 }
 
-uint8_t* BufferIterator::read(size_t size)
+BufferView BufferIterator::read_view(size_t size)
 {
-  assert(size > 0);
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < size)
+  BufferView view;
+  if (!try_read_view(size, view))
   {
+    size_t remaining_size = get_remaining_size();
     throw std::runtime_error(StringFormatter() << "Cannot read data from BufferIterator, not enough bytes remain: " << size << " bytes left: " << remaining_size);
   }
 
-  uint8_t *data = (uint8_t*)calloc(size, 1);
-  if (data == nullptr)
+  return view;
+}
+
+bool BufferIterator::try_read_view(size_t size, BufferView &view)
+{
+  if (get_remaining_size() < size && !fill(size))
   {
-    throw std::runtime_error(StringFormatter() << "Failed to read data from BufferIterator with size: " << size);
+    return false;
   }
 
-  const uint8_t *remaining_data = get_remaining_data();
-  memcpy(data, remaining_data, size);
+  view = BufferView(get_remaining_data(), size);
   offset_ += size;
-  return data;
+  return true;
 }
 
 void BufferIterator::skip_read(size_t size)
 {
   assert(size > 0);
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < size)
+  if (get_remaining_size() < size && !fill(size))
   {
+    size_t remaining_size = get_remaining_size();
     throw std::runtime_error(StringFormatter() << "Cannot skip read for BufferIterator, not enough bytes remain: " << size << " bytes left: " << remaining_size);
   }
 
   offset_ += size;
 }
 
-uint8_t BufferIterator::read_uint8()
+uint32_t BufferIterator::read_varuint32()
 {
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < 1)
-  {
-    throw std::runtime_error(StringFormatter() << "Cannot read uint8 from BufferIterator, not enough bytes remain!");
-  }
+  return (uint32_t)read_varuint(VARINT_MAX_SIZE32);
+}
 
-  const uint8_t *data = buffer_->get_data();
-  assert(data != nullptr);
+int32_t BufferIterator::read_varint32()
+{
+  return zigzag_decode32(read_varuint32());
+}
 
-  size_t offset = offset_;
-  offset_ += 1;
-  return (uint8_t)data[offset];
+uint64_t BufferIterator::read_varuint64()
+{
+  return read_varuint(VARINT_MAX_SIZE64);
 }
 
-int8_t BufferIterator::read_int8()
+int64_t BufferIterator::read_varint64()
 {
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < 1)
+  return zigzag_decode64(read_varuint64());
+}
+
+void BufferIterator::read_varuint32_array(uint32_t *values, size_t count)
+{
+  if (count == 0)
   {
-    throw std::runtime_error(StringFormatter() << "Cannot read int8 from BufferIterator, not enough bytes remain!");
+    return;
   }
 
-  const uint8_t *data = buffer_->get_data();
-  assert(data != nullptr);
+  // the control bytes tell how many value bytes follow them
+  size_t control_size = get_stream_vbyte_control_size(count);
+  if (get_remaining_size() < control_size && !fill(control_size))
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot read varint array from BufferIterator, not enough bytes remain: " << control_size << " bytes left: " << get_remaining_size());
+  }
+
+  size_t size = control_size + get_stream_vbyte_data_size(get_remaining_data(), count);
+  if (get_remaining_size() < size && !fill(size))
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot read varint array from BufferIterator, not enough bytes remain: " << size << " bytes left: " << get_remaining_size());
+  }
 
-  size_t offset = offset_;
-  offset_ += 1;
-  return (int8_t)data[offset];
+  stream_vbyte_decode(values, get_remaining_data(), count);
+  offset_ += size;
 }
 
-uint16_t BufferIterator::read_uint16()
+bool BufferIterator::try_read_varuint32(uint32_t &value)
 {
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < 2)
+  uint64_t v = 0;
+  if (!try_read_varuint(VARINT_MAX_SIZE32, v))
   {
-    throw std::runtime_error(StringFormatter() << "Cannot read uint16 from BufferIterator, not enough bytes remain!");
+    return false;
   }
 
-  const uint8_t *data = buffer_->get_data();
-  assert(data != nullptr);
+  value = (uint32_t)v;
+  return true;
+}
 
-  size_t offset = offset_;
-  offset_ += 2;
-  uint16_t value = (uint16_t)data[offset + 1] << 8 |
-                   (uint16_t)data[offset + 0] << 0;
+bool BufferIterator::try_read_varint32(int32_t &value)
+{
+  uint32_t v = 0;
+  if (!try_read_varuint32(v))
+  {
+    return false;
+  }
 
-  return value;
+  value = zigzag_decode32(v);
+  return true;
 }
 
-int16_t BufferIterator::read_int16()
+bool BufferIterator::try_read_varuint64(uint64_t &value)
 {
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < 2)
+  return try_read_varuint(VARINT_MAX_SIZE64, value);
+}
+
+bool BufferIterator::try_read_varint64(int64_t &value)
+{
+  uint64_t v = 0;
+  if (!try_read_varuint64(v))
   {
-    throw std::runtime_error(StringFormatter() << "Cannot read int16 from BufferIterator, not enough bytes remain!");
+    return false;
   }
 
-  const uint8_t *data = buffer_->get_data();
-  assert(data != nullptr);
+  value = zigzag_decode64(v);
+  return true;
+}
 
-  size_t offset = offset_;
-  offset_ += 2;
-  int16_t value = (int16_t)data[offset + 1] << 8 |
-                  (int16_t)data[offset + 0] << 0;
+uint64_t BufferIterator::read_varuint(size_t max_size)
+{
+  uint64_t value = 0;
+  if (!try_read_varuint(max_size, value))
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot read varint from BufferIterator, not enough bytes remain: " << get_remaining_size());
+  }
 
   return value;
 }
 
-uint32_t BufferIterator::read_uint32()
+bool BufferIterator::try_read_varuint(size_t max_size, uint64_t &value)
 {
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < 4)
+  while (true)
   {
-    throw std::runtime_error(StringFormatter() << "Cannot read uint32 from BufferIterator, not enough bytes remain!");
+    uint64_t v = 0;
+    size_t remaining_size = get_remaining_size();
+    size_t size = decode_varuint(get_remaining_data(), remaining_size, max_size, v);
+    if (size > 0)
+    {
+      if (max_size == VARINT_MAX_SIZE32 && v > std::numeric_limits<uint32_t>::max())
+      {
+        throw std::runtime_error(StringFormatter() << "Cannot read varint from BufferIterator, value overflows 32 bits: " << v);
+      }
+      else if (size == VARINT_MAX_SIZE64 && get_remaining_data()[size - 1] > 0x01)
+      {
+        // only the lowest bit of the tenth byte fits, the rest would be shifted out
+        throw std::runtime_error("Cannot read varint from BufferIterator, value overflows 64 bits");
+      }
+
+      value = v;
+      offset_ += size;
+      return true;
+    }
+    else if (remaining_size >= max_size)
+    {
+      throw std::runtime_error(StringFormatter() << "Cannot read varint from BufferIterator, encoding is longer than: " << max_size << " bytes");
+    }
+    else if (!fill(remaining_size + 1))
+    {
+      return false;
+    }
   }
+}
 
-  const uint8_t *data = buffer_->get_data();
-  assert(data != nullptr);
+std::string BufferIterator::read_string8()
+{
+  return read_string8_view().to_string();
+}
 
-  size_t offset = offset_;
-  offset_ += 4;
-  uint32_t value = (uint32_t)data[offset + 3] << 24 |
-                   (uint32_t)data[offset + 2] << 16 |
-                   (uint32_t)data[offset + 1] <<  8 |
-                   (uint32_t)data[offset + 0] <<  0;
+std::string BufferIterator::read_string16()
+{
+  return read_string16_view().to_string();
+}
 
-  return value;
+std::string BufferIterator::read_string32()
+{
+  return read_string32_view().to_string();
 }
 
-int32_t BufferIterator::read_int32()
+std::string BufferIterator::read_string64()
 {
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < 4)
-  {
-    throw std::runtime_error(StringFormatter() << "Cannot read int32 from BufferIterator, not enough bytes remain!");
-  }
+  return read_string64_view().to_string();
+}
 
-  const uint8_t *data = buffer_->get_data();
-  assert(data != nullptr);
+std::string BufferIterator::read_string()
+{
+  return read_string_view().to_string();
+}
 
-  size_t offset = offset_;
-  offset_ += 4;
-  int32_t value = (int32_t)data[offset + 3] << 24 |
-                  (int32_t)data[offset + 2] << 16 |
-                  (int32_t)data[offset + 1] <<  8 |
-                  (int32_t)data[offset + 0] <<  0;
+std::string BufferIterator::read_padded_string(size_t padded_size)
+{
+  return read_padded_string_view(padded_size).to_string();
+}
 
-  return value;
+BufferView BufferIterator::read_string8_view()
+{
+  uint8_t size = read_uint8();
+  return read_view(size);
+}
+
+BufferView BufferIterator::read_string16_view()
+{
+  uint16_t size = read_uint16();
+  return read_view(size);
+}
+
+BufferView BufferIterator::read_string32_view()
+{
+  uint32_t size = read_uint32();
+  return read_view(size);
+}
+
+BufferView BufferIterator::read_string64_view()
+{
+  uint64_t size = read_uint64();
+  return read_view(size);
 }
 
-uint64_t BufferIterator::read_uint64()
+BufferView BufferIterator::read_string_view()
 {
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < 8)
+  uint8_t string_type = read_uint8();
+  switch (string_type)
   {
-    throw std::runtime_error(StringFormatter() << "Cannot read uint64 from BufferIterator, not enough bytes remain!");
+    case BufferStringTypes::STRING8:
+      return read_string8_view();
+    case BufferStringTypes::STRING16:
+      return read_string16_view();
+    case BufferStringTypes::STRING32:
+      return read_string32_view();
+    case BufferStringTypes::STRING64:
+      return read_string64_view();
+    default:
+      throw std::runtime_error(StringFormatter() << "Failed to read string of unknown type: " << (uint32_t)string_type);
   }
+}
 
-  const uint8_t *data = buffer_->get_data();
-  assert(data != nullptr);
+BufferView BufferIterator::read_padded_string_view(size_t padded_size)
+{
+  assert(padded_size > 0);
+  return read_view(padded_size);
+}
 
-  size_t offset = offset_;
-  offset_ += 8;
-  uint64_t value = (uint64_t)data[offset + 7] << 56 |
-                   (uint64_t)data[offset + 6] << 48 |
-                   (uint64_t)data[offset + 5] << 40 |
-                   (uint64_t)data[offset + 4] << 32 |
-                   (uint64_t)data[offset + 3] << 24 |
-                   (uint64_t)data[offset + 2] << 16 |
-                   (uint64_t)data[offset + 1] <<  8 |
-                   (uint64_t)data[offset + 0] <<  0;
+bool BufferIterator::try_read_string8(std::string &str)
+{
+  BufferView view;
+  if (!try_read_string8_view(view))
+  {
+    return false;
+  }
 
-  return value;
+  str = view.to_string();
+  return true;
 }
 
-int64_t BufferIterator::read_int64()
+bool BufferIterator::try_read_string16(std::string &str)
 {
-  size_t remaining_size = get_remaining_size();
-  if (remaining_size < 8)
+  BufferView view;
+  if (!try_read_string16_view(view))
   {
-    throw std::runtime_error(StringFormatter() << "Cannot read int64 from BufferIterator, not enough bytes remain!");
+    return false;
   }
 
-  const uint8_t *data = buffer_->get_data();
-  assert(data != nullptr);
+  str = view.to_string();
+  return true;
+}
 
-  size_t offset = offset_;
-  offset_ += 8;
-  int64_t value = (int64_t)data[offset + 7] << 56 |
-                  (int64_t)data[offset + 6] << 48 |
-                  (int64_t)data[offset + 5] << 40 |
-                  (int64_t)data[offset + 4] << 32 |
-                  (int64_t)data[offset + 3] << 24 |
-                  (int64_t)data[offset + 2] << 16 |
-                  (int64_t)data[offset + 1] <<  8 |
-                  (int64_t)data[offset + 0] <<  0;
+bool BufferIterator::try_read_string32(std::string &str)
+{
+  BufferView view;
+  if (!try_read_string32_view(view))
+  {
+    return false;
+  }
 
-  return value;
+  str = view.to_string();
+  return true;
+}
+
+bool BufferIterator::try_read_string64(std::string &str)
+{
+  BufferView view;
+  if (!try_read_string64_view(view))
+  {
+    return false;
+  }
+
+  str = view.to_string();
+  return true;
 }
 
-float BufferIterator::read_float32()
+bool BufferIterator::try_read_string(std::string &str)
 {
-  uint32_t value = read_uint32();
-  float v = 0.0f;
-  memcpy(&v, &value, 4);
-  return v;
+  BufferView view;
+  if (!try_read_string_view(view))
+  {
+    return false;
+  }
+
+  str = view.to_string();
+  return true;
 }
 
-double BufferIterator::read_float64()
+bool BufferIterator::try_read_padded_string(size_t padded_size, std::string &str)
 {
-  uint64_t value = read_uint64();
-  double v = 0.0f;
-  memcpy(&v, &value, 8);
-  return v;
+  BufferView view;
+  if (!try_read_padded_string_view(padded_size, view))
+  {
+    return false;
+  }
+
+  str = view.to_string();
+  return true;
 }
 
-std::string BufferIterator::read_string8()
+bool BufferIterator::try_read_string8_view(BufferView &view)
 {
-  uint8_t size = read_uint8();
-  uint8_t *data = read(size);
-  std::string str((char*)data, size);
-  free(data);
-  return str;
+  return try_read_sized_view(0, 1, view);
 }
 
-std::string BufferIterator::read_string16()
+bool BufferIterator::try_read_string16_view(BufferView &view)
 {
-  uint16_t size = read_uint16();
-  uint8_t *data = read(size);
-  std::string str((char*)data, size);
-  free(data);
-  return str;
+  return try_read_sized_view(0, 2, view);
 }
 
-std::string BufferIterator::read_string32()
+bool BufferIterator::try_read_string32_view(BufferView &view)
 {
-  uint32_t size = read_uint32();
-  uint8_t *data = read(size);
-  std::string str((char*)data, size);
-  free(data);
-  return str;
+  return try_read_sized_view(0, 4, view);
 }
 
-std::string BufferIterator::read_string64()
+bool BufferIterator::try_read_string64_view(BufferView &view)
 {
-  uint64_t size = read_uint64();
-  uint8_t *data = read(size);
-  std::string str((char*)data, size);
-  free(data);
-  return str;
+  return try_read_sized_view(0, 8, view);
 }
 
-std::string BufferIterator::read_string()
+bool BufferIterator::try_read_string_view(BufferView &view)
 {
-  uint8_t string_type = read_uint8();
+  if (get_remaining_size() < 1 && !fill(1))
+  {
+    return false;
+  }
+
+  // the string type byte is only consumed along with the rest of the string
+  uint8_t string_type = get_remaining_data()[0];
   switch (string_type)
   {
     case BufferStringTypes::STRING8:
-      return read_string8();
+      return try_read_sized_view(1, 1, view);
     case BufferStringTypes::STRING16:
-      return read_string16();
+      return try_read_sized_view(1, 2, view);
     case BufferStringTypes::STRING32:
-      return read_string32();
+      return try_read_sized_view(1, 4, view);
     case BufferStringTypes::STRING64:
-      return read_string64();
+      return try_read_sized_view(1, 8, view);
     default:
-      throw std::runtime_error(StringFormatter() << "Failed to read string of unknown type: " << string_type);
+      throw std::runtime_error(StringFormatter() << "Failed to read string of unknown type: " << (uint32_t)string_type);
   }
 }
 
-std::string BufferIterator::read_padded_string(size_t padded_size)
+bool BufferIterator::try_read_padded_string_view(size_t padded_size, BufferView &view)
 {
   assert(padded_size > 0);
-  uint8_t *data = read(padded_size);
-  std::string str((char*)data, padded_size);
-  free(data);
-  return str;
+  return try_read_view(padded_size, view);
+}
+
+bool BufferIterator::try_read_sized_view(size_t header_size, size_t prefix_size, BufferView &view)
+{
+  // peek at the size prefix without consuming it, a refill keeps every unread
+  // byte so nothing is lost when the string itself turns out to be incomplete
+  size_t size = header_size + prefix_size;
+  if (get_remaining_size() < size && !fill(size))
+  {
+    return false;
+  }
+
+  const uint8_t *prefix = get_remaining_data() + header_size;
+  uint64_t string_size = 0;
+  switch (prefix_size)
+  {
+    case 1:
+      string_size = prefix[0];
+      break;
+    case 2:
+      string_size = load_ordered<BUFFER_BYTE_ORDER_LITTLE, uint16_t>(prefix);
+      break;
+    case 4:
+      string_size = load_ordered<BUFFER_BYTE_ORDER_LITTLE, uint32_t>(prefix);
+      break;
+    default:
+      string_size = load_ordered<BUFFER_BYTE_ORDER_LITTLE, uint64_t>(prefix);
+      break;
+  }
+
+  if (string_size > std::numeric_limits<size_t>::max() - size)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to read string with invalid size: " << string_size);
+  }
+
+  size += string_size;
+  if (get_remaining_size() < size && !fill(size))
+  {
+    return false;
+  }
+
+  view = BufferView(get_remaining_data() + header_size + prefix_size, string_size);
+  offset_ += size;
+  return true;
 }
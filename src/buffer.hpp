@@ -31,10 +31,20 @@
 #include <cstdint>
 #include <cstring>
 
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <tuple>
+#include <utility>
 
 #include "utils.hpp"
+#include "allocator.hpp"
+#include "byte_order.hpp"
+#include "varint.hpp"
+
+// arrays that do not fit in the space left are converted through a scratch
+// chunk of this size, so a streaming buffer never has to hold all of them
+static const size_t BUFFER_ARRAY_CHUNK_SIZE = 1024;
 
 typedef enum : uint8_t
 {
@@ -44,31 +54,212 @@ typedef enum : uint8_t
   STRING64
 } BufferStringTypes;
 
+// the combined size of a list of fixed width fields
+template <typename... Types>
+struct BufferFieldsSize;
+
+template <>
+struct BufferFieldsSize<>
+{
+  static const size_t value = 0;
+};
+
+template <typename Type, typename... Types>
+struct BufferFieldsSize<Type, Types...>
+{
+  static const size_t value = sizeof(Type) + BufferFieldsSize<Types...>::value;
+};
+
+// a fixed width value written ahead of time and filled in later, such as
+// the length prefix of a nested message whose size is not yet known
+template <typename Type>
+struct BufferSlot
+{
+  size_t offset;
+  size_t generation;
+};
+
+// a savepoint that a buffer can be rewound to, dropping what came after
+struct BufferMark
+{
+  size_t offset;
+  size_t size;
+  size_t generation;
+};
+
+// the fixed width values that the generic read<T>() and write<T>() accept,
+// the name is used in the error raised when a read runs out of bytes
+template <typename Type>
+struct BufferValueTraits
+{
+  static const bool is_value = false;
+};
+
+template <>
+struct BufferValueTraits<uint8_t>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "uint8"; }
+};
+
+template <>
+struct BufferValueTraits<int8_t>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "int8"; }
+};
+
+template <>
+struct BufferValueTraits<uint16_t>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "uint16"; }
+};
+
+template <>
+struct BufferValueTraits<int16_t>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "int16"; }
+};
+
+template <>
+struct BufferValueTraits<uint32_t>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "uint32"; }
+};
+
+template <>
+struct BufferValueTraits<int32_t>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "int32"; }
+};
+
+template <>
+struct BufferValueTraits<uint64_t>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "uint64"; }
+};
+
+template <>
+struct BufferValueTraits<int64_t>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "int64"; }
+};
+
+template <>
+struct BufferValueTraits<float>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "float32"; }
+};
+
+template <>
+struct BufferValueTraits<double>
+{
+  static const bool is_value = true;
+  static const char* get_name() { return "float64"; }
+};
+
+// whether every one of a list of fields is a fixed width value
+template <typename... Types>
+struct BufferFieldsAreValues;
+
+template <>
+struct BufferFieldsAreValues<>
+{
+  static const bool value = true;
+};
+
+template <typename Type, typename... Types>
+struct BufferFieldsAreValues<Type, Types...>
+{
+  static const bool value = BufferValueTraits<Type>::is_value && BufferFieldsAreValues<Types...>::value;
+};
+
+// a non-owning view of bytes that live in some other storage, a view
+// is only valid for as long as the storage it points into is unchanged
+class BufferView
+{
+public:
+  BufferView(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+  BufferView() {}
+
+  const uint8_t* get_data() const { return data_; }
+  const char* get_chars() const { return (const char*)data_; }
+  size_t get_size() const { return size_; }
+  bool is_empty() const { return size_ == 0; }
+
+  std::string to_string() const { return std::string((const char*)data_, size_); }
+
+  bool compare(const BufferView &other) const
+  {
+    return size_ == other.size_ && (size_ == 0 || memcmp(data_, other.data_, size_) == 0);
+  }
+
+  bool compare(const std::string &str) const
+  {
+    return size_ == str.size() && (size_ == 0 || memcmp(data_, str.data(), size_) == 0);
+  }
+
+private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+};
+
 class Buffer
 {
 public:
   Buffer(const uint8_t *data, size_t size, size_t offset);
   Buffer(const uint8_t *data, size_t size);
+  Buffer(uint8_t *data, size_t size, size_t capacity, BufferAllocator *allocator);
+  Buffer(BufferAllocator *allocator);
+  Buffer(Buffer &&other);
   Buffer();
   virtual ~Buffer();
 
+  Buffer& operator = (Buffer &&other);
+
   void clear();
+  void swap(Buffer &other);
+  uint8_t* release();
+
+  void set_allocator(BufferAllocator *allocator);
+  BufferAllocator* get_allocator() const;
 
   void set_data(const uint8_t *data, size_t size);
   const uint8_t* get_data() const;
 
+  void set_borrowed_data(const uint8_t *data, size_t size);
+  bool is_borrowed() const;
+
   void set_size(size_t size);
   size_t get_size() const;
 
   void set_offset(size_t offset);
   size_t get_offset() const;
 
+  size_t get_capacity() const;
+
   void copy(Buffer *other_buffer);
   bool compare(const Buffer *other_buffer) const;
 
+  virtual void reserve(size_t capacity);
+  virtual void shrink_to_fit();
+
   void resize(size_t size);
-  void write(const uint8_t *data, size_t size);
-  void pad(size_t size);
+  virtual void write(const uint8_t *data, size_t size);
+  virtual void pad(size_t size);
+
+  uint8_t* prepare(size_t size);
+  void commit(size_t size);
+
+  template <typename Type>
+  void write(Type value);
 
   void write_uint8(uint8_t value);
   void write_int8(int8_t value);
@@ -85,6 +276,14 @@ public:
   void write_float32(float value);
   void write_float64(double value);
 
+  void write_varuint32(uint32_t value);
+  void write_varint32(int32_t value);
+
+  void write_varuint64(uint64_t value);
+  void write_varint64(int64_t value);
+
+  void write_varuint32_array(const uint32_t *values, size_t count);
+
   void write_string8(const char *string, uint8_t size);
   void write_string8(std::string str);
 
@@ -103,10 +302,51 @@ public:
   void write_padded_string(const char *string, size_t size, size_t padded_size);
   void write_padded_string(std::string str, size_t padded_size);
 
+  template <typename Type>
+  void write_array(const Type *values, size_t count);
+
+  template <typename... Types>
+  void write_fields(Types... values);
+
+  template <BufferByteOrder Order, typename Type>
+  void write_ordered(Type value);
+
+  template <typename Type>
+  BufferSlot<Type> reserve_slot();
+
+  template <typename Type>
+  void patch(BufferSlot<Type> slot, Type value);
+
+  BufferMark mark() const;
+  void rewind(BufferMark mark);
+
+  template <BufferByteOrder Order, typename Type>
+  void write_ordered_array(const Type *values, size_t count);
+
 protected:
+  virtual void grow(size_t size);
+
+  // storage that is not ours but that we may write to, such as the inline
+  // bytes of an InlineBuffer or a writable mapping. it cannot be handed to
+  // another buffer, unlike borrowed data which always has a zero capacity.
+  // subclasses that free borrowed storage themselves must also report it
+  virtual bool has_external_storage() const { return !owns_data_ && capacity_ > 0; }
+
+  // bumped whenever written bytes leave the storage, such as a flush or a
+  // new segment, so marks and slots taken before it are known to be stale
+  void invalidate_marks() { generation_++; }
+
   uint8_t *data_ = nullptr;
   size_t size_ = 0;
   size_t offset_ = 0;
+  size_t capacity_ = 0;
+  BufferAllocator *allocator_ = BufferAllocator::get_default();
+  bool owns_data_ = true;
+  size_t generation_ = 0;
+
+private:
+  Buffer(const Buffer&);
+  Buffer& operator = (const Buffer&);
 };
 
 class BufferIterator
@@ -132,8 +372,12 @@ public:
   const uint8_t* get_remaining_data() const;
 
   uint8_t* read(size_t size);
+  BufferView read_view(size_t size);
   void skip_read(size_t size);
 
+  template <typename Type>
+  Type read();
+
   uint8_t read_uint8();
   int8_t read_int8();
 
@@ -149,6 +393,14 @@ public:
   float read_float32();
   double read_float64();
 
+  uint32_t read_varuint32();
+  int32_t read_varint32();
+
+  uint64_t read_varuint64();
+  int64_t read_varint64();
+
+  void read_varuint32_array(uint32_t *values, size_t count);
+
   std::string read_string8();
   std::string read_string16();
   std::string read_string32();
@@ -158,9 +410,502 @@ public:
 
   std::string read_padded_string(size_t padded_size);
 
+  BufferView read_string8_view();
+  BufferView read_string16_view();
+  BufferView read_string32_view();
+  BufferView read_string64_view();
+
+  BufferView read_string_view();
+
+  BufferView read_padded_string_view(size_t padded_size);
+
+  // the try_read_* methods return false instead of throwing when not
+  // enough bytes remain, and then leave the offset where it was. data that
+  // is malformed rather than incomplete still throws
+  template <typename Type>
+  bool try_read(Type &value);
+
+  bool try_read_uint8(uint8_t &value);
+  bool try_read_int8(int8_t &value);
+
+  bool try_read_uint16(uint16_t &value);
+  bool try_read_int16(int16_t &value);
+
+  bool try_read_uint32(uint32_t &value);
+  bool try_read_int32(int32_t &value);
+
+  bool try_read_uint64(uint64_t &value);
+  bool try_read_int64(int64_t &value);
+
+  bool try_read_float32(float &value);
+  bool try_read_float64(double &value);
+
+  bool try_read_varuint32(uint32_t &value);
+  bool try_read_varint32(int32_t &value);
+
+  bool try_read_varuint64(uint64_t &value);
+  bool try_read_varint64(int64_t &value);
+
+  bool try_read_view(size_t size, BufferView &view);
+
+  bool try_read_string8(std::string &str);
+  bool try_read_string16(std::string &str);
+  bool try_read_string32(std::string &str);
+  bool try_read_string64(std::string &str);
+
+  bool try_read_string(std::string &str);
+
+  bool try_read_padded_string(size_t padded_size, std::string &str);
+
+  bool try_read_string8_view(BufferView &view);
+  bool try_read_string16_view(BufferView &view);
+  bool try_read_string32_view(BufferView &view);
+  bool try_read_string64_view(BufferView &view);
+
+  bool try_read_string_view(BufferView &view);
+
+  bool try_read_padded_string_view(size_t padded_size, BufferView &view);
+
+  template <typename Type>
+  void read_array(Type *values, size_t count);
+
+  template <typename... Types>
+  std::tuple<Types...> read_fields();
+
+  template <typename... Types>
+  void read_fields(Types&... values);
+
+  template <BufferByteOrder Order, typename Type>
+  Type read_ordered();
+
+  template <BufferByteOrder Order, typename Type>
+  void read_ordered_array(Type *values, size_t count);
+
 protected:
+  uint64_t read_varuint(size_t max_size);
+  bool try_read_varuint(size_t max_size, uint64_t &value);
+  bool try_read_sized_view(size_t header_size, size_t prefix_size, BufferView &view);
+
+  template <typename Tuple, size_t... Indices>
+  void read_tuple_fields(Tuple &values, std::index_sequence<Indices...>);
+
+  // called when fewer than size bytes remain, an iterator over a source
+  // that can be refilled makes at least size bytes available and returns
+  // true, otherwise the read fails
+  virtual bool fill(size_t size);
+
   const Buffer *buffer_ = nullptr;
   size_t offset_ = 0;
 };
 
+// the accessors and fixed width reads and writes are defined here so that
+// they inline into the caller's loop, only growing and refilling go
+// through an out of line call
+
+inline const uint8_t* Buffer::get_data() const
+{
+  return data_;
+}
+
+inline size_t Buffer::get_size() const
+{
+  return size_;
+}
+
+inline void Buffer::resize(size_t size)
+{
+  assert(size > 0);
+  if (offset_ + size > capacity_)
+  {
+    grow(size);
+  }
+
+  // the new bytes are left uninitialized, every caller
+  // overwrites them immediately after resizing
+  size_t end = offset_ + size;
+  if (end > size_)
+  {
+    size_ = end;
+  }
+}
+
+// writes a fixed width value in little endian, the byte order of the
+// wire format, for example write<uint32_t>(value)
+template <typename Type>
+inline void Buffer::write(Type value)
+{
+  static_assert(BufferValueTraits<Type>::is_value, "Only fixed width values can be written!");
+  resize(sizeof(Type));
+  store_ordered<BUFFER_BYTE_ORDER_LITTLE>(data_ + offset_, value);
+  offset_ += sizeof(Type);
+}
+
+inline void Buffer::write_uint8(uint8_t value)
+{
+  write<uint8_t>(value);
+}
+
+inline void Buffer::write_int8(int8_t value)
+{
+  write<int8_t>(value);
+}
+
+inline void Buffer::write_uint16(uint16_t value)
+{
+  write<uint16_t>(value);
+}
+
+inline void Buffer::write_int16(int16_t value)
+{
+  write<int16_t>(value);
+}
+
+inline void Buffer::write_uint32(uint32_t value)
+{
+  write<uint32_t>(value);
+}
+
+inline void Buffer::write_int32(int32_t value)
+{
+  write<int32_t>(value);
+}
+
+inline void Buffer::write_uint64(uint64_t value)
+{
+  write<uint64_t>(value);
+}
+
+inline void Buffer::write_int64(int64_t value)
+{
+  write<int64_t>(value);
+}
+
+inline void Buffer::write_float32(float value)
+{
+  write<float>(value);
+}
+
+inline void Buffer::write_float64(double value)
+{
+  write<double>(value);
+}
+
+inline size_t BufferIterator::get_remaining_size() const
+{
+  return buffer_->get_size() - offset_;
+}
+
+inline const uint8_t* BufferIterator::get_remaining_data() const
+{
+  return buffer_->get_data() + offset_;
+}
+
+template <typename Type>
+inline bool BufferIterator::try_read(Type &value)
+{
+  static_assert(BufferValueTraits<Type>::is_value, "Only fixed width values can be read!");
+  if (get_remaining_size() < sizeof(Type) && !fill(sizeof(Type)))
+  {
+    return false;
+  }
+
+  value = load_ordered<BUFFER_BYTE_ORDER_LITTLE, Type>(get_remaining_data());
+  offset_ += sizeof(Type);
+  return true;
+}
+
+template <typename Type>
+inline Type BufferIterator::read()
+{
+  Type value;
+  if (!try_read(value))
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot read " << BufferValueTraits<Type>::get_name() << " from BufferIterator, not enough bytes remain!");
+  }
+
+  return value;
+}
+
+inline uint8_t BufferIterator::read_uint8()
+{
+  return read<uint8_t>();
+}
+
+inline int8_t BufferIterator::read_int8()
+{
+  return read<int8_t>();
+}
+
+inline uint16_t BufferIterator::read_uint16()
+{
+  return read<uint16_t>();
+}
+
+inline int16_t BufferIterator::read_int16()
+{
+  return read<int16_t>();
+}
+
+inline uint32_t BufferIterator::read_uint32()
+{
+  return read<uint32_t>();
+}
+
+inline int32_t BufferIterator::read_int32()
+{
+  return read<int32_t>();
+}
+
+inline uint64_t BufferIterator::read_uint64()
+{
+  return read<uint64_t>();
+}
+
+inline int64_t BufferIterator::read_int64()
+{
+  return read<int64_t>();
+}
+
+inline float BufferIterator::read_float32()
+{
+  return read<float>();
+}
+
+inline double BufferIterator::read_float64()
+{
+  return read<double>();
+}
+
+inline bool BufferIterator::try_read_uint8(uint8_t &value)
+{
+  return try_read<uint8_t>(value);
+}
+
+inline bool BufferIterator::try_read_int8(int8_t &value)
+{
+  return try_read<int8_t>(value);
+}
+
+inline bool BufferIterator::try_read_uint16(uint16_t &value)
+{
+  return try_read<uint16_t>(value);
+}
+
+inline bool BufferIterator::try_read_int16(int16_t &value)
+{
+  return try_read<int16_t>(value);
+}
+
+inline bool BufferIterator::try_read_uint32(uint32_t &value)
+{
+  return try_read<uint32_t>(value);
+}
+
+inline bool BufferIterator::try_read_int32(int32_t &value)
+{
+  return try_read<int32_t>(value);
+}
+
+inline bool BufferIterator::try_read_uint64(uint64_t &value)
+{
+  return try_read<uint64_t>(value);
+}
+
+inline bool BufferIterator::try_read_int64(int64_t &value)
+{
+  return try_read<int64_t>(value);
+}
+
+inline bool BufferIterator::try_read_float32(float &value)
+{
+  return try_read<float>(value);
+}
+
+inline bool BufferIterator::try_read_float64(double &value)
+{
+  return try_read<double>(value);
+}
+
+// writes an array of fixed width values with a single size check, the
+// values are copied with one memcpy, or byte swapped with vector shuffles
+// on big endian hosts
+template <typename Type>
+inline void Buffer::write_array(const Type *values, size_t count)
+{
+  write_ordered_array<BUFFER_BYTE_ORDER_LITTLE>(values, count);
+}
+
+// writes a list of fixed width fields with a single size check, the
+// fields are stored back to back exactly as the named write_* methods would
+template <typename... Types>
+inline void Buffer::write_fields(Types... values)
+{
+  static_assert(BufferFieldsAreValues<Types...>::value, "Only fixed width values can be written as fields!");
+  const size_t size = BufferFieldsSize<Types...>::value;
+  resize(size);
+
+  uint8_t *data = data_ + offset_;
+  size_t field_offset = 0;
+  int fields[] = { 0, (store_ordered<BUFFER_BYTE_ORDER_LITTLE>(data + field_offset, values), field_offset += sizeof(Types), 0)... };
+  (void)fields;
+
+  offset_ += size;
+}
+
+// writes zeros in place of a value that is patched in later, slots refer
+// to a position in the buffer's storage, so patching one throws once a
+// StreamWriter has flushed it or a ChainedBuffer has moved to a new segment
+template <typename Type>
+inline BufferSlot<Type> Buffer::reserve_slot()
+{
+  static_assert(BufferValueTraits<Type>::is_value, "Only fixed width values can be reserved!");
+  resize(sizeof(Type));
+
+  BufferSlot<Type> slot = { offset_, generation_ };
+  memset(data_ + offset_, 0, sizeof(Type));
+  offset_ += sizeof(Type);
+  return slot;
+}
+
+template <typename Type>
+inline void Buffer::patch(BufferSlot<Type> slot, Type value)
+{
+  if (slot.generation != generation_)
+  {
+    throw std::runtime_error("Cannot patch slot, its bytes have left the buffer's storage!");
+  }
+
+  if (slot.offset > size_ || sizeof(Type) > size_ - slot.offset)
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot patch slot at offset: " << slot.offset << ", buffer size: " << size_);
+  }
+
+  store_ordered<BUFFER_BYTE_ORDER_LITTLE>(data_ + slot.offset, value);
+}
+
+// writes a value in an explicit byte order, the named write_* methods
+// use little endian which is the byte order of the wire format
+template <BufferByteOrder Order, typename Type>
+inline void Buffer::write_ordered(Type value)
+{
+  resize(sizeof(Type));
+  store_ordered<Order>(data_ + offset_, value);
+  offset_ += sizeof(Type);
+}
+
+template <BufferByteOrder Order, typename Type>
+inline void Buffer::write_ordered_array(const Type *values, size_t count)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  // values already in the right order go through write(), so that
+  // streaming buffers can split them instead of growing to hold them
+  if (Order == BUFFER_BYTE_ORDER_HOST || sizeof(Type) == 1)
+  {
+    write((const uint8_t*)values, count * sizeof(Type));
+    return;
+  }
+
+  while (count > 0)
+  {
+    // convert in place whatever fits in the current storage
+    size_t fit_count = offset_ < capacity_ ? (capacity_ - offset_) / sizeof(Type) : 0;
+    if (fit_count > 0)
+    {
+      fit_count = std::min(fit_count, count);
+      store_ordered_array<Order>(data_ + offset_, values, fit_count);
+      offset_ += fit_count * sizeof(Type);
+      if (offset_ > size_)
+      {
+        size_ = offset_;
+      }
+
+      values += fit_count;
+      count -= fit_count;
+      continue;
+    }
+
+    // the next chunk goes through write(), which grows the buffer, flushes
+    // a StreamWriter or starts a new ChainedBuffer segment to make room
+    alignas(Type) uint8_t chunk[BUFFER_ARRAY_CHUNK_SIZE];
+    size_t chunk_count = std::min(count, sizeof(chunk) / sizeof(Type));
+    store_ordered_array<Order>(chunk, values, chunk_count);
+    write(chunk, chunk_count * sizeof(Type));
+
+    values += chunk_count;
+    count -= chunk_count;
+  }
+}
+
+template <typename Type>
+inline void BufferIterator::read_array(Type *values, size_t count)
+{
+  read_ordered_array<BUFFER_BYTE_ORDER_LITTLE>(values, count);
+}
+
+// reads a list of fixed width fields with a single size check and returns
+// them as a tuple, for example read_fields<uint32_t, uint16_t, double>()
+template <typename... Types>
+inline std::tuple<Types...> BufferIterator::read_fields()
+{
+  static_assert(BufferFieldsAreValues<Types...>::value, "Only fixed width values can be read as fields!");
+  std::tuple<Types...> values;
+  read_tuple_fields(values, std::index_sequence_for<Types...>());
+  return values;
+}
+
+// reads a list of fixed width fields with a single size check into the
+// given variables, which may be the members of a header struct
+template <typename... Types>
+inline void BufferIterator::read_fields(Types&... values)
+{
+  static_assert(BufferFieldsAreValues<Types...>::value, "Only fixed width values can be read as fields!");
+  const size_t size = BufferFieldsSize<Types...>::value;
+  if (get_remaining_size() < size && !fill(size))
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot read fields from BufferIterator, not enough bytes remain: " << size << " bytes left: " << get_remaining_size());
+  }
+
+  const uint8_t *data = get_remaining_data();
+  size_t field_offset = 0;
+  int fields[] = { 0, (values = load_ordered<BUFFER_BYTE_ORDER_LITTLE, Types>(data + field_offset), field_offset += sizeof(Types), 0)... };
+  (void)fields;
+
+  offset_ += size;
+}
+
+template <typename Tuple, size_t... Indices>
+inline void BufferIterator::read_tuple_fields(Tuple &values, std::index_sequence<Indices...>)
+{
+  read_fields(std::get<Indices>(values)...);
+}
+
+template <BufferByteOrder Order, typename Type>
+inline Type BufferIterator::read_ordered()
+{
+  if (get_remaining_size() < sizeof(Type) && !fill(sizeof(Type)))
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot read value from BufferIterator, not enough bytes remain: " << sizeof(Type) << " bytes left: " << get_remaining_size());
+  }
+
+  Type value = load_ordered<Order, Type>(get_remaining_data());
+  offset_ += sizeof(Type);
+  return value;
+}
+
+template <BufferByteOrder Order, typename Type>
+inline void BufferIterator::read_ordered_array(Type *values, size_t count)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  BufferView view = read_view(count * sizeof(Type));
+  load_ordered_array<Order>(values, view.get_data(), count);
+}
+
 #endif // _BUFFER_H
@@ -0,0 +1,145 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+
+#include "cpu.hpp"
+#include "byte_order.hpp"
+
+typedef void (*ByteSwapArrayFunction)(uint8_t *dst, const uint8_t *src, size_t count, size_t width);
+
+template <typename Word>
+static inline void byte_swap_words(uint8_t *dst, const uint8_t *src, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    Word word;
+    memcpy(&word, src + i * sizeof(Word), sizeof(Word));
+    word = byte_swap(word);
+    memcpy(dst + i * sizeof(Word), &word, sizeof(Word));
+  }
+}
+
+static void byte_swap_array_scalar(uint8_t *dst, const uint8_t *src, size_t count, size_t width)
+{
+  switch (width)
+  {
+    case 2:
+      byte_swap_words<uint16_t>(dst, src, count);
+      break;
+    case 4:
+      byte_swap_words<uint32_t>(dst, src, count);
+      break;
+    case 8:
+      byte_swap_words<uint64_t>(dst, src, count);
+      break;
+    default:
+      break;
+  }
+}
+
+#ifdef SERIALBUF_X86
+
+// the pshufb control that reverses every value of the given width in a lane
+static const uint8_t *get_byte_swap_shuffle(size_t width)
+{
+  alignas(16) static const uint8_t shuffles[3][16] = {
+    { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+    { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+    { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 }
+  };
+
+  return width == 2 ? shuffles[0] : width == 4 ? shuffles[1] : shuffles[2];
+}
+
+__attribute__((target("ssse3")))
+static void byte_swap_array_ssse3(uint8_t *dst, const uint8_t *src, size_t count, size_t width)
+{
+  const __m128i shuffle = _mm_load_si128((const __m128i*)get_byte_swap_shuffle(width));
+  size_t size = count * width;
+  size_t offset = 0;
+
+  for (; offset + 16 <= size; offset += 16)
+  {
+    __m128i value = _mm_loadu_si128((const __m128i*)(src + offset));
+    _mm_storeu_si128((__m128i*)(dst + offset), _mm_shuffle_epi8(value, shuffle));
+  }
+
+  byte_swap_array_scalar(dst + offset, src + offset, (size - offset) / width, width);
+}
+
+__attribute__((target("avx2")))
+static void byte_swap_array_avx2(uint8_t *dst, const uint8_t *src, size_t count, size_t width)
+{
+  // vpshufb shuffles within each 128 bit lane, so both lanes use the same control
+  const __m256i shuffle = _mm256_broadcastsi128_si256(
+    _mm_load_si128((const __m128i*)get_byte_swap_shuffle(width)));
+
+  size_t size = count * width;
+  size_t offset = 0;
+
+  for (; offset + 32 <= size; offset += 32)
+  {
+    __m256i value = _mm256_loadu_si256((const __m256i*)(src + offset));
+    _mm256_storeu_si256((__m256i*)(dst + offset), _mm256_shuffle_epi8(value, shuffle));
+  }
+
+  byte_swap_array_scalar(dst + offset, src + offset, (size - offset) / width, width);
+}
+
+#endif // SERIALBUF_X86
+
+static ByteSwapArrayFunction resolve_byte_swap_array()
+{
+#ifdef SERIALBUF_X86
+  if (cpu_has_avx2())
+  {
+    return byte_swap_array_avx2;
+  }
+  else if (cpu_has_ssse3())
+  {
+    return byte_swap_array_ssse3;
+  }
+#endif
+
+  return byte_swap_array_scalar;
+}
+
+void byte_swap_array(uint8_t *dst, const uint8_t *src, size_t count, size_t width)
+{
+  assert(width == 1 || width == 2 || width == 4 || width == 8);
+  if (width == 1)
+  {
+    if (dst != src)
+    {
+      memcpy(dst, src, count);
+    }
+
+    return;
+  }
+
+  static const ByteSwapArrayFunction function = resolve_byte_swap_array();
+  function(dst, src, count, width);
+}
@@ -0,0 +1,167 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _BYTE_ORDER_H
+#define _BYTE_ORDER_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#include <type_traits>
+
+typedef enum : uint8_t
+{
+  BUFFER_BYTE_ORDER_LITTLE = 0,
+  BUFFER_BYTE_ORDER_BIG,
+  BUFFER_BYTE_ORDER_NETWORK = BUFFER_BYTE_ORDER_BIG,
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  BUFFER_BYTE_ORDER_HOST = BUFFER_BYTE_ORDER_BIG
+#else
+  BUFFER_BYTE_ORDER_HOST = BUFFER_BYTE_ORDER_LITTLE
+#endif
+} BufferByteOrder;
+
+// the unsigned integer type with the same width as a value, every
+// value is moved through one of these to be byte swapped
+template <size_t Size>
+struct ByteOrderWord;
+
+template <>
+struct ByteOrderWord<1>
+{
+  typedef uint8_t type;
+};
+
+template <>
+struct ByteOrderWord<2>
+{
+  typedef uint16_t type;
+};
+
+template <>
+struct ByteOrderWord<4>
+{
+  typedef uint32_t type;
+};
+
+template <>
+struct ByteOrderWord<8>
+{
+  typedef uint64_t type;
+};
+
+inline uint8_t byte_swap(uint8_t value)
+{
+  return value;
+}
+
+inline uint16_t byte_swap(uint16_t value)
+{
+  return __builtin_bswap16(value);
+}
+
+inline uint32_t byte_swap(uint32_t value)
+{
+  return __builtin_bswap32(value);
+}
+
+inline uint64_t byte_swap(uint64_t value)
+{
+  return __builtin_bswap64(value);
+}
+
+// stores a value in the given byte order, the order is known at compile
+// time so this is a single store, preceded by a bswap when it differs
+// from the host order. the destination does not need to be aligned
+template <BufferByteOrder Order, typename Type>
+inline void store_ordered(uint8_t *data, Type value)
+{
+  static_assert(std::is_arithmetic<Type>::value, "Only arithmetic types have a byte order!");
+  typedef typename ByteOrderWord<sizeof(Type)>::type Word;
+
+  Word word;
+  memcpy(&word, &value, sizeof(Word));
+  if (Order != BUFFER_BYTE_ORDER_HOST)
+  {
+    word = byte_swap(word);
+  }
+
+  memcpy(data, &word, sizeof(Word));
+}
+
+template <BufferByteOrder Order, typename Type>
+inline Type load_ordered(const uint8_t *data)
+{
+  static_assert(std::is_arithmetic<Type>::value, "Only arithmetic types have a byte order!");
+  typedef typename ByteOrderWord<sizeof(Type)>::type Word;
+
+  Word word;
+  memcpy(&word, data, sizeof(Word));
+  if (Order != BUFFER_BYTE_ORDER_HOST)
+  {
+    word = byte_swap(word);
+  }
+
+  Type value;
+  memcpy(&value, &word, sizeof(Word));
+  return value;
+}
+
+// reverses the bytes of count values of the given width (1, 2, 4 or 8),
+// using vector shuffles when the cpu supports them. the source and the
+// destination may be the same, but must not otherwise overlap
+void byte_swap_array(uint8_t *dst, const uint8_t *src, size_t count, size_t width);
+
+template <BufferByteOrder Order, typename Type>
+inline void store_ordered_array(uint8_t *data, const Type *values, size_t count)
+{
+  static_assert(std::is_arithmetic<Type>::value, "Only arithmetic types have a byte order!");
+  if (Order == BUFFER_BYTE_ORDER_HOST || sizeof(Type) == 1)
+  {
+    memcpy(data, values, count * sizeof(Type));
+  }
+  else
+  {
+    byte_swap_array(data, (const uint8_t*)values, count, sizeof(Type));
+  }
+}
+
+template <BufferByteOrder Order, typename Type>
+inline void load_ordered_array(Type *values, const uint8_t *data, size_t count)
+{
+  static_assert(std::is_arithmetic<Type>::value, "Only arithmetic types have a byte order!");
+  if (Order == BUFFER_BYTE_ORDER_HOST || sizeof(Type) == 1)
+  {
+    memcpy(values, data, count * sizeof(Type));
+  }
+  else
+  {
+    byte_swap_array((uint8_t*)values, data, count, sizeof(Type));
+  }
+}
+
+#endif // _BYTE_ORDER_H
@@ -0,0 +1,321 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <algorithm>
+
+#include "chained_buffer.hpp"
+
+static const size_t CHAINED_BUFFER_DEFAULT_SEGMENT_SIZE = 16 * 1024;
+
+ChainedBuffer::ChainedBuffer(size_t segment_size)
+  : Buffer(), segment_size_(segment_size)
+{
+  assert(segment_size > 0);
+}
+
+ChainedBuffer::ChainedBuffer(BufferAllocator *allocator)
+  : ChainedBuffer(CHAINED_BUFFER_DEFAULT_SEGMENT_SIZE)
+{
+  set_allocator(allocator);
+}
+
+ChainedBuffer::ChainedBuffer() : ChainedBuffer(CHAINED_BUFFER_DEFAULT_SEGMENT_SIZE)
+{
+
+}
+
+ChainedBuffer::~ChainedBuffer()
+{
+  clear();
+}
+
+void ChainedBuffer::clear()
+{
+  for (const ChainedBufferSegment &segment : segments_)
+  {
+    allocator_->deallocate(segment.data, segment.capacity);
+  }
+
+  segments_.clear();
+  sealed_size_ = 0;
+
+  // the segments were ours, the base class only forgets about them
+  data_ = nullptr;
+  Buffer::clear();
+}
+
+void ChainedBuffer::set_allocator(BufferAllocator *allocator)
+{
+  // the base class check misses the segments, which the chain frees itself
+  if (!segments_.empty())
+  {
+    throw std::runtime_error("Cannot change the allocator of a ChainedBuffer that holds segments!");
+  }
+
+  Buffer::set_allocator(allocator);
+}
+
+size_t ChainedBuffer::get_segment_size() const
+{
+  return segment_size_;
+}
+
+size_t ChainedBuffer::get_segment_count() const
+{
+  return segments_.size();
+}
+
+BufferView ChainedBuffer::get_segment(size_t index) const
+{
+  assert(index < segments_.size());
+
+  // the current segment is always the last one, and its size is only
+  // recorded in the segment list once it has been filled
+  const ChainedBufferSegment &segment = segments_[index];
+  if (data_ != nullptr && index == segments_.size() - 1)
+  {
+    return BufferView(data_, size_);
+  }
+
+  return BufferView(segment.data, segment.size);
+}
+
+size_t ChainedBuffer::get_total_size() const
+{
+  return sealed_size_ + (data_ != nullptr ? size_ : 0);
+}
+
+void ChainedBuffer::get_iovecs(std::vector<struct iovec> &iovecs) const
+{
+  iovecs.clear();
+  for (size_t i = 0; i < segments_.size(); i++)
+  {
+    BufferView segment = get_segment(i);
+    if (!segment.is_empty())
+    {
+      iovecs.push_back({ (void*)segment.get_data(), segment.get_size() });
+    }
+  }
+}
+
+void ChainedBuffer::prepend(const uint8_t *data, size_t size)
+{
+  assert(data != nullptr);
+  assert(size > 0);
+
+  uint8_t *segment_data = allocator_->allocate(size);
+  if (segment_data == nullptr)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to allocate chained buffer segment with size: " << size);
+  }
+
+  memcpy(segment_data, data, size);
+  segments_.insert(segments_.begin(), { segment_data, size, size });
+  sealed_size_ += size;
+}
+
+void ChainedBuffer::reserve(size_t capacity)
+{
+  // segments never move, so instead of growing the current segment
+  // a new one is started that can hold all of the requested capacity
+  if (capacity > capacity_)
+  {
+    add_segment(std::max(segment_size_, capacity));
+  }
+}
+
+void ChainedBuffer::shrink_to_fit()
+{
+  // segments are never reallocated
+}
+
+void ChainedBuffer::write(const uint8_t *data, size_t size)
+{
+  assert(data != nullptr);
+  assert(size > 0);
+
+  // fill up the current segment before starting the next one
+  while (size > 0)
+  {
+    if (offset_ == capacity_)
+    {
+      add_segment(segment_size_);
+    }
+
+    size_t write_size = std::min(size, capacity_ - offset_);
+    memcpy(data_ + offset_, data, write_size);
+    offset_ += write_size;
+    if (offset_ > size_)
+    {
+      size_ = offset_;
+    }
+
+    data += write_size;
+    size -= write_size;
+  }
+}
+
+void ChainedBuffer::pad(size_t size)
+{
+  assert(size > 0);
+  while (size > 0)
+  {
+    if (offset_ == capacity_)
+    {
+      add_segment(segment_size_);
+    }
+
+    size_t pad_size = std::min(size, capacity_ - offset_);
+    memset(data_ + offset_, 0, pad_size);
+    offset_ += pad_size;
+    if (offset_ > size_)
+    {
+      size_ = offset_;
+    }
+
+    size -= pad_size;
+  }
+}
+
+void ChainedBuffer::grow(size_t size)
+{
+  // a single value is never split, it goes at the start of a new
+  // segment and whatever is left of the current one goes unused
+  add_segment(std::max(segment_size_, size));
+}
+
+void ChainedBuffer::add_segment(size_t capacity)
+{
+  uint8_t *data = allocator_->allocate(capacity);
+  if (data == nullptr)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to allocate chained buffer segment with size: " << capacity);
+  }
+
+  if (data_ != nullptr)
+  {
+    segments_.back().size = size_;
+    sealed_size_ += size_;
+  }
+
+  segments_.push_back({ data, 0, capacity });
+  invalidate_marks();
+
+  // the segment list owns the storage, so the base class
+  // must never free or reallocate the current segment
+  data_ = data;
+  size_ = 0;
+  offset_ = 0;
+  capacity_ = capacity;
+  owns_data_ = false;
+}
+
+ChainedBufferIterator::ChainedBufferIterator(const ChainedBuffer *buffer)
+  : BufferIterator(), chain_(buffer)
+{
+  assert(buffer != nullptr);
+  set_buffer(&window_);
+}
+
+ChainedBufferIterator::~ChainedBufferIterator()
+{
+  window_.clear();
+}
+
+size_t ChainedBufferIterator::get_position() const
+{
+  return window_position_ + offset_;
+}
+
+bool ChainedBufferIterator::fill(size_t size)
+{
+  size_t remaining_size = window_.get_size() - offset_;
+  size_t segment_count = chain_->get_segment_count();
+
+  // make sure the rest of the chain holds enough bytes before touching
+  // anything, a failed read must leave the iterator where it was
+  size_t available_size = remaining_size;
+  for (size_t i = next_segment_; i < segment_count && available_size < size; i++)
+  {
+    available_size += chain_->get_segment(i).get_size() - (i == next_segment_ ? next_offset_ : 0);
+  }
+
+  if (available_size < size)
+  {
+    return false;
+  }
+
+  window_position_ += offset_;
+  if (remaining_size == 0)
+  {
+    while (chain_->get_segment(next_segment_).get_size() == next_offset_)
+    {
+      next_segment_++;
+      next_offset_ = 0;
+    }
+
+    // the value lies within the next segment, read it in place
+    BufferView segment = chain_->get_segment(next_segment_);
+    if (segment.get_size() - next_offset_ >= size)
+    {
+      window_.set_borrowed_data(segment.get_data() + next_offset_, segment.get_size() - next_offset_);
+      next_segment_++;
+      next_offset_ = 0;
+      offset_ = 0;
+      return true;
+    }
+  }
+
+  // the value straddles segments, gather exactly its bytes
+  if (remaining_size > 0 && window_.get_data() == scratch_.data())
+  {
+    memmove(scratch_.data(), scratch_.data() + offset_, remaining_size);
+    scratch_.resize(remaining_size);
+  }
+  else
+  {
+    const uint8_t *remaining_data = window_.get_data() + offset_;
+    scratch_.assign(remaining_data, remaining_data + remaining_size);
+  }
+
+  while (scratch_.size() < size)
+  {
+    BufferView segment = chain_->get_segment(next_segment_);
+    size_t gather_size = std::min(size - scratch_.size(), segment.get_size() - next_offset_);
+    const uint8_t *segment_data = segment.get_data() + next_offset_;
+    scratch_.insert(scratch_.end(), segment_data, segment_data + gather_size);
+
+    next_offset_ += gather_size;
+    if (next_offset_ == segment.get_size())
+    {
+      next_segment_++;
+      next_offset_ = 0;
+    }
+  }
+
+  window_.set_borrowed_data(scratch_.data(), scratch_.size());
+  offset_ = 0;
+  return true;
+}
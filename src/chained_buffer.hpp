@@ -0,0 +1,152 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _CHAINED_BUFFER_H
+#define _CHAINED_BUFFER_H
+
+#include <cstdlib>
+#include <cstdint>
+
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "buffer.hpp"
+
+struct ChainedBufferSegment
+{
+  uint8_t *data;
+  size_t size;
+  size_t capacity;
+};
+
+// a buffer made of a chain of fixed size segments, a write that does not
+// fit the current segment starts a new one, so bytes already written are
+// never moved. bytes can be prepended as a segment of their own, and the
+// whole chain can be handed to writev or sendmsg without joining it.
+// the chain is not a Buffer to its users, the base class accessors only
+// see the current segment, so just the write methods are made public
+class ChainedBuffer : private Buffer
+{
+public:
+  ChainedBuffer(size_t segment_size);
+  ChainedBuffer(BufferAllocator *allocator);
+  ChainedBuffer();
+  ~ChainedBuffer();
+
+  void clear();
+
+  void set_allocator(BufferAllocator *allocator);
+  using Buffer::get_allocator;
+
+  size_t get_segment_size() const;
+  size_t get_segment_count() const;
+  BufferView get_segment(size_t index) const;
+  size_t get_total_size() const;
+
+  void get_iovecs(std::vector<struct iovec> &iovecs) const;
+
+  void prepend(const uint8_t *data, size_t size);
+
+  void reserve(size_t capacity);
+  void shrink_to_fit();
+
+  using Buffer::write;
+  void write(const uint8_t *data, size_t size);
+  void pad(size_t size);
+
+  using Buffer::prepare;
+  using Buffer::commit;
+
+  using Buffer::write_uint8;
+  using Buffer::write_int8;
+  using Buffer::write_uint16;
+  using Buffer::write_int16;
+  using Buffer::write_uint32;
+  using Buffer::write_int32;
+  using Buffer::write_uint64;
+  using Buffer::write_int64;
+  using Buffer::write_float32;
+  using Buffer::write_float64;
+
+  using Buffer::write_varuint32;
+  using Buffer::write_varint32;
+  using Buffer::write_varuint64;
+  using Buffer::write_varint64;
+  using Buffer::write_varuint32_array;
+
+  using Buffer::write_string8;
+  using Buffer::write_string16;
+  using Buffer::write_string32;
+  using Buffer::write_string64;
+  using Buffer::write_string;
+  using Buffer::write_padded_string;
+
+  using Buffer::write_array;
+  using Buffer::write_fields;
+  using Buffer::write_ordered;
+  using Buffer::write_ordered_array;
+
+  using Buffer::reserve_slot;
+  using Buffer::patch;
+  using Buffer::mark;
+  using Buffer::rewind;
+
+protected:
+  void grow(size_t size);
+
+private:
+  void add_segment(size_t capacity);
+
+  std::vector<ChainedBufferSegment> segments_;
+  size_t segment_size_ = 0;
+  size_t sealed_size_ = 0;
+};
+
+// an iterator over a chained buffer, a value that lies within one segment
+// is read from the segment directly, one that straddles segments is first
+// gathered into a small scratch buffer. views returned by the read_*_view
+// methods are invalidated when the iterator moves on to the next segment
+class ChainedBufferIterator : public BufferIterator
+{
+public:
+  ChainedBufferIterator(const ChainedBuffer *buffer);
+  ~ChainedBufferIterator();
+
+  size_t get_position() const;
+
+protected:
+  bool fill(size_t size);
+
+private:
+  const ChainedBuffer *chain_ = nullptr;
+  size_t next_segment_ = 0;
+  size_t next_offset_ = 0;
+  size_t window_position_ = 0;
+  std::vector<uint8_t> scratch_;
+  Buffer window_;
+};
+
+#endif // _CHAINED_BUFFER_H
@@ -0,0 +1,68 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _CPU_H
+#define _CPU_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SERIALBUF_X86 1
+#include <immintrin.h>
+#endif
+
+// runtime cpu feature detection, the vectorized code paths are compiled
+// for their instruction set with target attributes and only selected when
+// the cpu running the program supports it
+
+inline bool cpu_has_sse2()
+{
+#ifdef SERIALBUF_X86
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse2");
+#else
+  return false;
+#endif
+}
+
+inline bool cpu_has_ssse3()
+{
+#ifdef SERIALBUF_X86
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("ssse3");
+#else
+  return false;
+#endif
+}
+
+inline bool cpu_has_avx2()
+{
+#ifdef SERIALBUF_X86
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+#endif // _CPU_H
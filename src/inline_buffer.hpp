@@ -0,0 +1,132 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _INLINE_BUFFER_H
+#define _INLINE_BUFFER_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#include "buffer.hpp"
+
+// a buffer that keeps its first Size bytes inside the object, so a short
+// message built on the stack never allocates. once a write needs more room
+// the data moves to the allocator the same way a borrowed buffer's does
+template <size_t Size>
+class InlineBuffer : public Buffer
+{
+public:
+  InlineBuffer(BufferAllocator *allocator);
+  InlineBuffer(InlineBuffer &&other);
+  InlineBuffer();
+
+  InlineBuffer& operator = (InlineBuffer &&other);
+
+  void clear();
+
+  bool is_inline() const;
+
+private:
+  void reset();
+
+  uint8_t inline_data_[Size];
+};
+
+template <size_t Size>
+inline InlineBuffer<Size>::InlineBuffer(BufferAllocator *allocator) : InlineBuffer()
+{
+  set_allocator(allocator);
+}
+
+template <size_t Size>
+inline InlineBuffer<Size>::InlineBuffer(InlineBuffer &&other) : InlineBuffer()
+{
+  *this = std::move(other);
+}
+
+template <size_t Size>
+inline InlineBuffer<Size>::InlineBuffer()
+{
+  static_assert(Size > 0, "An InlineBuffer must have room for at least one byte!");
+  reset();
+}
+
+template <size_t Size>
+inline InlineBuffer<Size>& InlineBuffer<Size>::operator = (InlineBuffer &&other)
+{
+  if (this == &other)
+  {
+    return *this;
+  }
+
+  clear();
+  allocator_ = other.allocator_;
+  if (other.is_inline())
+  {
+    memcpy(inline_data_, other.inline_data_, other.size_);
+    size_ = other.size_;
+    offset_ = other.offset_;
+  }
+  else
+  {
+    // take the other buffer's heap or borrowed data as is
+    data_ = other.data_;
+    size_ = other.size_;
+    offset_ = other.offset_;
+    capacity_ = other.capacity_;
+    owns_data_ = other.owns_data_;
+  }
+
+  other.reset();
+  return *this;
+}
+
+template <size_t Size>
+inline void InlineBuffer<Size>::clear()
+{
+  Buffer::clear();
+  reset();
+}
+
+template <size_t Size>
+inline bool InlineBuffer<Size>::is_inline() const
+{
+  return data_ == inline_data_;
+}
+
+template <size_t Size>
+inline void InlineBuffer<Size>::reset()
+{
+  // the inline bytes are not ours to free, which is what keeps the
+  // base class from handing them to the allocator
+  data_ = inline_data_;
+  size_ = 0;
+  offset_ = 0;
+  capacity_ = Size;
+  owns_data_ = false;
+}
+
+#endif // _INLINE_BUFFER_H
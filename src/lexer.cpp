@@ -23,6 +23,12 @@
 // You should have received a copy of the MIT License
 // along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
 
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <iterator>
+
+#include "cpu.hpp"
 #include "lexer.hpp"
 
 LexerToken::LexerToken(const Lexer *lexer, size_t lineno, size_t begin_pos, size_t end_pos)
@@ -134,11 +140,37 @@ const StringToken* StringToken::as_string_token() const
 void StringToken::set_value(std::string value)
 {
   value_ = value;
+  view_ = BufferView();
+  owns_value_ = true;
 }
 
 std::string StringToken::get_value() const
 {
-  return value_;
+  return owns_value_ ? value_ : view_.to_string();
+}
+
+void StringToken::set_view(BufferView view)
+{
+  value_.clear();
+  view_ = view;
+  owns_value_ = false;
+}
+
+BufferView StringToken::get_view() const
+{
+  // an owned value is viewed where it is now, a copied or moved
+  // token must not point into the string of the one it came from
+  if (owns_value_)
+  {
+    return BufferView((const uint8_t*)value_.data(), value_.size());
+  }
+
+  return view_;
+}
+
+bool StringToken::owns_value() const
+{
+  return owns_value_;
 }
 
 uint8_t LiteralToken::get_type() const
@@ -193,30 +225,23 @@ bool NumberToken::get_is_floating_point() const
 
 void NumberToken::clear()
 {
-  if (value_ != nullptr)
-  {
-    free(value_);
-    value_ = nullptr;
-  }
-
+  value_.uint64_value = 0;
+  value_type_ = 0;
   is_negative_ = false;
   is_floating_point_ = false;
 }
 
 void NumberToken::size(size_t size)
 {
-  value_ = (uint8_t*)calloc(size, 1);
-  if (value_ == nullptr)
-  {
-    throw std::runtime_error("Failed to resize NumberToken value, could not allocate enough memory!");
-  }
+  // the value is held inline, there is nothing to allocate
+  assert(size <= sizeof(value_));
+  value_.uint64_value = 0;
 }
 
 void NumberToken::set_value(int8_t value)
 {
   clear();
-  size(sizeof(int8_t));
-  memcpy(value_, &value, sizeof(int8_t));
+  value_.int8_value = value;
   value_type_ = LEXER_INT_INT8;
   is_negative_ = true;
 }
@@ -224,16 +249,14 @@ void NumberToken::set_value(int8_t value)
 void NumberToken::set_value(uint8_t value)
 {
   clear();
-  size(sizeof(uint8_t));
-  memcpy(value_, &value, sizeof(uint8_t));
+  value_.uint8_value = value;
   value_type_ = LEXER_INT_UINT8;
 }
 
 void NumberToken::set_value(int16_t value)
 {
   clear();
-  size(sizeof(int16_t));
-  memcpy(value_, &value, sizeof(int16_t));
+  value_.int16_value = value;
   value_type_ = LEXER_INT_INT16;
   is_negative_ = true;
 }
@@ -241,16 +264,14 @@ void NumberToken::set_value(int16_t value)
 void NumberToken::set_value(uint16_t value)
 {
   clear();
-  size(sizeof(uint16_t));
-  memcpy(value_, &value, sizeof(uint16_t));
+  value_.uint16_value = value;
   value_type_ = LEXER_INT_UINT16;
 }
 
 void NumberToken::set_value(int32_t value)
 {
   clear();
-  size(sizeof(int32_t));
-  memcpy(value_, &value, sizeof(int32_t));
+  value_.int32_value = value;
   value_type_ = LEXER_INT_INT32;
   is_negative_ = true;
 }
@@ -258,16 +279,14 @@ void NumberToken::set_value(int32_t value)
 void NumberToken::set_value(uint32_t value)
 {
   clear();
-  size(sizeof(uint32_t));
-  memcpy(value_, &value, sizeof(uint32_t));
+  value_.uint32_value = value;
   value_type_ = LEXER_INT_UINT32;
 }
 
 void NumberToken::set_value(int64_t value)
 {
   clear();
-  size(sizeof(int64_t));
-  memcpy(value_, &value, sizeof(int64_t));
+  value_.int64_value = value;
   value_type_ = LEXER_INT_INT64;
   is_negative_ = true;
 }
@@ -275,16 +294,14 @@ void NumberToken::set_value(int64_t value)
 void NumberToken::set_value(uint64_t value)
 {
   clear();
-  size(sizeof(uint64_t));
-  memcpy(value_, &value, sizeof(uint64_t));
+  value_.uint64_value = value;
   value_type_ = LEXER_INT_UINT64;
 }
 
 void NumberToken::set_value(float value)
 {
   clear();
-  size(sizeof(float));
-  memcpy(value_, &value, sizeof(float));
+  value_.float_value = value;
   value_type_ = LEXER_INT_FLOAT;
   is_negative_ = value < 0;
   is_floating_point_ = true;
@@ -293,8 +310,7 @@ void NumberToken::set_value(float value)
 void NumberToken::set_value(double value)
 {
   clear();
-  size(sizeof(double));
-  memcpy(value_, &value, sizeof(double));
+  value_.double_value = value;
   value_type_ = LEXER_INT_DOUBLE;
   is_negative_ = value < 0;
   is_floating_point_ = true;
@@ -362,7 +378,7 @@ void NumberToken::set_compact_value(double value)
 
 uint8_t* NumberToken::get_value() const
 {
-  return value_;
+  return (uint8_t*)&value_;
 }
 
 uint8_t NumberToken::get_value_type() const
@@ -372,102 +388,52 @@ uint8_t NumberToken::get_value_type() const
 
 int8_t NumberToken::get_int8() const
 {
-  int8_t value = 0;
-  memcpy(&value, value_, sizeof(int8_t));
-  if (is_negative_)
-  {
-    value = -value;
-  }
-
-  return value;
+  return value_.int8_value;
 }
 
 uint8_t NumberToken::get_uint8() const
 {
-  uint8_t value = 0;
-  memcpy(&value, value_, sizeof(uint8_t));
-  return value;
+  return value_.uint8_value;
 }
 
 int16_t NumberToken::get_int16() const
 {
-  int16_t value = 0;
-  memcpy(&value, value_, sizeof(int16_t));
-  if (is_negative_)
-  {
-    value = -value;
-  }
-
-  return value;
+  return value_.int16_value;
 }
 
 uint16_t NumberToken::get_uint16() const
 {
-  uint16_t value = 0;
-  memcpy(&value, value_, sizeof(uint16_t));
-  return value;
+  return value_.uint16_value;
 }
 
 int32_t NumberToken::get_int32() const
 {
-  int32_t value = 0;
-  memcpy(&value, value_, sizeof(int32_t));
-  if (is_negative_)
-  {
-    value = -value;
-  }
-
-  return value;
+  return value_.int32_value;
 }
 
 uint32_t NumberToken::get_uint32() const
 {
-  uint32_t value = 0;
-  memcpy(&value, value_, sizeof(uint32_t));
-  return value;
+  return value_.uint32_value;
 }
 
 int64_t NumberToken::get_int64() const
 {
-  int64_t value = 0;
-  memcpy(&value, value_, sizeof(int64_t));
-  if (is_negative_)
-  {
-    value = -value;
-  }
-
-  return value;
+  return value_.int64_value;
 }
 
 uint64_t NumberToken::get_uint64() const
 {
-  uint64_t value = 0;
-  memcpy(&value, value_, sizeof(uint64_t));
-  return value;
+  return value_.uint64_value;
 }
 
 float NumberToken::get_float() const
 {
-  float value = 0;
-  memcpy(&value, value_, sizeof(float));
-  if (is_negative_)
-  {
-    value = -value;
-  }
-
-  return value;
+  return value_.float_value;
 }
 
 double NumberToken::get_double() const
 {
-  double value = 0;
-  memcpy(&value, value_, sizeof(double));
-  if (is_negative_)
-  {
-    value = -value;
-  }
-
-  return value;
+  return value_.double_value;
 }
 
 uint8_t NameToken::get_type() const
@@ -500,25 +466,53 @@ const PunctuationToken* PunctuationToken::as_punctuation_token() const
   return this;
 }
 
-Lexer::Lexer(std::istringstream &stream)
-  : stream_(stream), current_line_(""), current_lineno_(0), current_offset_(0)
+Lexer::Lexer(const char *data, size_t size)
+  : data_(data), size_(size)
+{
+  assert(data != nullptr || size == 0);
+}
+
+Lexer::Lexer(const Buffer *buffer)
+  : Lexer((const char*)buffer->get_data(), buffer->get_size())
 {
 
 }
 
+Lexer::Lexer(std::istringstream &stream)
+{
+  // read the rest of the stream once, the lexer then works on it in place
+  source_.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  data_ = source_.data();
+  size_ = source_.size();
+}
+
 Lexer::~Lexer()
 {
-  stream_.clear();
+
 }
 
 void Lexer::set_current_line(std::string current_line)
 {
-  current_line_ = current_line;
+  // splice the given line in place of the current one and keep the rest
+  // of the source, records that point into the old source are invalidated
+  size_t current_offset = std::min(get_current_offset(), current_line.size());
+  size_t line_end = get_line_end();
+
+  std::string source;
+  source.reserve(line_begin_ + current_line.size() + size_ - line_end);
+  source.append(data_, line_begin_);
+  source.append(current_line);
+  source.append(data_ + line_end, size_ - line_end);
+
+  source_.swap(source);
+  data_ = source_.data();
+  size_ = source_.size();
+  position_ = line_begin_ + current_offset;
 }
 
 std::string Lexer::get_current_line()
 {
-  return current_line_;
+  return std::string(data_ + line_begin_, get_line_end() - line_begin_);
 }
 
 void Lexer::set_current_lineno(size_t current_lineno)
@@ -533,158 +527,724 @@ size_t Lexer::get_current_lineno()
 
 void Lexer::set_current_offset(size_t current_offset)
 {
-  current_offset_ = current_offset;
+  position_ = line_begin_ + current_offset;
 }
 
 size_t Lexer::get_current_offset()
 {
-  return current_offset_;
+  return position_ - line_begin_;
 }
 
-const NumberToken* Lexer::read_number()
+size_t Lexer::get_line_end() const
 {
-  size_t offset = current_offset_;
+  if (line_begin_ >= size_)
+  {
+    return size_;
+  }
 
-  bool is_negative = false;
-  bool is_floating_point = false;
-  std::string number_str;
+  const char *line_end = (const char*)memchr(data_ + line_begin_, '\n', size_ - line_begin_);
+  return line_end != nullptr ? line_end - data_ : size_;
+}
 
-  // check to see if this is a negative number
-  if (offset > 0)
+static inline bool is_digit_char(int c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static inline bool is_name_char(int c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline int get_hex_value(int c)
+{
+  if (c >= '0' && c <= '9')
   {
-    int c = current_line_[offset - 1];
-    if (c == '-')
-    {
-      is_negative = true;
-      number_str += c;
-    }
+    return c - '0';
+  }
+  else if (c >= 'a' && c <= 'f')
+  {
+    return c - 'a' + 10;
+  }
+  else if (c >= 'A' && c <= 'F')
+  {
+    return c - 'A' + 10;
   }
 
-  int c = current_line_[offset];
+  return -1;
+}
 
-  do
+// the kinds of character runs the lexer skips over, a space run is
+// everything that cannot start a token other than a newline and a
+// quoted run is the text of a string up to a quote, backslash or newline
+typedef enum : uint8_t
+{
+  LEXER_RUN_NAME,
+  LEXER_RUN_DIGIT,
+  LEXER_RUN_SPACE,
+  LEXER_RUN_DOUBLE_QUOTED,
+  LEXER_RUN_SINGLE_QUOTED
+} LexerRun;
+
+typedef size_t (*LexerFindRunEndFunction)(const char *data, size_t size, uint8_t run);
+
+static inline bool is_run_char(int c, uint8_t run)
+{
+  switch (run)
   {
-    number_str += c;
-    if (c == '.')
-    {
-      is_floating_point = true;
-    }
+    case LEXER_RUN_NAME:
+      return is_name_char(c);
+    case LEXER_RUN_DIGIT:
+      return is_digit_char(c);
+    case LEXER_RUN_SPACE:
+      return !is_name_char(c) && !is_digit_char(c) &&
+        c != '.' && c != '"' && c != '\'' && c != '\n';
+    case LEXER_RUN_DOUBLE_QUOTED:
+      return c != '"' && c != '\\' && c != '\n';
+    default:
+      return c != '\'' && c != '\\' && c != '\n';
+  }
+}
 
+static size_t find_run_end_scalar(const char *data, size_t size, uint8_t run)
+{
+  size_t offset = 0;
+  while (offset < size && is_run_char(data[offset], run))
+  {
     offset++;
-    c = current_line_[offset];
-  } while (
-          (c >= '0' && c <= '9') ||
-          (c == '.' && current_line_[current_offset_ + 1] >= '0' &&
-          (c == '.' && current_line_[current_offset_ + 1] <= '9')));
+  }
 
-  NumberToken *token = new NumberToken(this, current_lineno_, current_offset_, offset);
-  if (is_floating_point)
+  return offset;
+}
+
+#ifdef SERIALBUF_X86
+
+// the characters are classified with range compares, a byte is in the
+// range [low, low + count] when subtracting low leaves it at most count,
+// which sse2 can test with an unsigned minimum
+__attribute__((target("sse2")))
+static inline __m128i in_range_sse2(__m128i value, char low, char count)
+{
+  __m128i offset = _mm_sub_epi8(value, _mm_set1_epi8(low));
+  return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(count)), offset);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i is_name_char_sse2(__m128i value)
+{
+  // setting bit 5 folds upper case letters onto lower case ones
+  return _mm_or_si128(
+    in_range_sse2(_mm_or_si128(value, _mm_set1_epi8(0x20)), 'a', 'z' - 'a'),
+    _mm_cmpeq_epi8(value, _mm_set1_epi8('_')));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i is_any_char_sse2(__m128i value, char c0, char c1, char c2)
+{
+  return _mm_or_si128(_mm_cmpeq_epi8(value, _mm_set1_epi8(c0)),
+    _mm_or_si128(_mm_cmpeq_epi8(value, _mm_set1_epi8(c1)), _mm_cmpeq_epi8(value, _mm_set1_epi8(c2))));
+}
+
+// returns a mask of the bytes that end the run
+__attribute__((target("sse2")))
+static inline uint32_t find_run_stops_sse2(__m128i value, uint8_t run)
+{
+  __m128i stop;
+  switch (run)
   {
-    size_t sz;
-    double value = std::stod(number_str, &sz);
-    token->set_compact_value(value);
+    case LEXER_RUN_NAME:
+      stop = _mm_andnot_si128(is_name_char_sse2(value), _mm_set1_epi8(-1));
+      break;
+    case LEXER_RUN_DIGIT:
+      stop = _mm_andnot_si128(in_range_sse2(value, '0', 9), _mm_set1_epi8(-1));
+      break;
+    case LEXER_RUN_SPACE:
+      stop = _mm_or_si128(
+        _mm_or_si128(is_name_char_sse2(value), in_range_sse2(value, '0', 9)),
+        _mm_or_si128(is_any_char_sse2(value, '.', '"', '\''), _mm_cmpeq_epi8(value, _mm_set1_epi8('\n'))));
+      break;
+    case LEXER_RUN_DOUBLE_QUOTED:
+      stop = is_any_char_sse2(value, '"', '\\', '\n');
+      break;
+    default:
+      stop = is_any_char_sse2(value, '\'', '\\', '\n');
+      break;
   }
-  else
+
+  return (uint32_t)_mm_movemask_epi8(stop);
+}
+
+__attribute__((target("sse2")))
+static size_t find_run_end_sse2(const char *data, size_t size, uint8_t run)
+{
+  size_t offset = 0;
+  for (; offset + 16 <= size; offset += 16)
   {
-    if (is_negative)
+    __m128i value = _mm_loadu_si128((const __m128i*)(data + offset));
+    uint32_t mask = find_run_stops_sse2(value, run);
+    if (mask != 0)
     {
-      size_t sz;
-      int64_t value = std::stoll(number_str, &sz, 0);
-      token->set_compact_value(value);
+      return offset + __builtin_ctz(mask);
     }
-    else
+  }
+
+  return offset + find_run_end_scalar(data + offset, size - offset, run);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i in_range_avx2(__m256i value, char low, char count)
+{
+  __m256i offset = _mm256_sub_epi8(value, _mm256_set1_epi8(low));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(count)), offset);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i is_name_char_avx2(__m256i value)
+{
+  return _mm256_or_si256(
+    in_range_avx2(_mm256_or_si256(value, _mm256_set1_epi8(0x20)), 'a', 'z' - 'a'),
+    _mm256_cmpeq_epi8(value, _mm256_set1_epi8('_')));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i is_any_char_avx2(__m256i value, char c0, char c1, char c2)
+{
+  return _mm256_or_si256(_mm256_cmpeq_epi8(value, _mm256_set1_epi8(c0)),
+    _mm256_or_si256(_mm256_cmpeq_epi8(value, _mm256_set1_epi8(c1)), _mm256_cmpeq_epi8(value, _mm256_set1_epi8(c2))));
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t find_run_stops_avx2(__m256i value, uint8_t run)
+{
+  __m256i stop;
+  switch (run)
+  {
+    case LEXER_RUN_NAME:
+      stop = _mm256_andnot_si256(is_name_char_avx2(value), _mm256_set1_epi8(-1));
+      break;
+    case LEXER_RUN_DIGIT:
+      stop = _mm256_andnot_si256(in_range_avx2(value, '0', 9), _mm256_set1_epi8(-1));
+      break;
+    case LEXER_RUN_SPACE:
+      stop = _mm256_or_si256(
+        _mm256_or_si256(is_name_char_avx2(value), in_range_avx2(value, '0', 9)),
+        _mm256_or_si256(is_any_char_avx2(value, '.', '"', '\''), _mm256_cmpeq_epi8(value, _mm256_set1_epi8('\n'))));
+      break;
+    case LEXER_RUN_DOUBLE_QUOTED:
+      stop = is_any_char_avx2(value, '"', '\\', '\n');
+      break;
+    default:
+      stop = is_any_char_avx2(value, '\'', '\\', '\n');
+      break;
+  }
+
+  return (uint32_t)_mm256_movemask_epi8(stop);
+}
+
+__attribute__((target("avx2")))
+static size_t find_run_end_avx2(const char *data, size_t size, uint8_t run)
+{
+  size_t offset = 0;
+  for (; offset + 32 <= size; offset += 32)
+  {
+    __m256i value = _mm256_loadu_si256((const __m256i*)(data + offset));
+    uint32_t mask = find_run_stops_avx2(value, run);
+    if (mask != 0)
     {
-      size_t sz;
-      uint64_t value = std::stoull(number_str, &sz, 0);
-      token->set_compact_value(value);
+      return offset + __builtin_ctz(mask);
     }
   }
 
-  current_offset_ = offset;
-  return token;
+  return offset + find_run_end_scalar(data + offset, size - offset, run);
 }
 
-const StringToken* Lexer::read_string()
+#endif // SERIALBUF_X86
+
+static LexerFindRunEndFunction resolve_find_run_end()
 {
-  size_t offset = current_offset_;
-  offset++; // skip over the first quote
+#ifdef SERIALBUF_X86
+  if (cpu_has_avx2())
+  {
+    return find_run_end_avx2;
+  }
+  else if (cpu_has_sse2())
+  {
+    return find_run_end_sse2;
+  }
+#endif
 
-  int c = current_line_[offset];
-  std::string str;
+  return find_run_end_scalar;
+}
 
-  while (c != '\"' && c != '\'')
+// returns the length of the run of the given kind at the start of data
+static inline size_t find_run_end(const char *data, size_t size, uint8_t run)
+{
+  // most runs are a few characters long and end before a vector
+  // would fill, those never pay for the indirect call
+  if (size < 16 || !is_run_char(data[0], run))
   {
-    str += c;
-    offset++;
-    c = current_line_[offset];
+    return find_run_end_scalar(data, size, run);
+  }
+
+  static const LexerFindRunEndFunction function = resolve_find_run_end();
+  return function(data, size, run);
+}
+
+static void set_compact_number(LexerTokenRecord &record, int64_t value)
+{
+  record.value_type = get_int_type(value);
+  switch (record.value_type)
+  {
+    case LEXER_INT_INT8:
+      record.value.int8_value = (int8_t)value;
+      break;
+    case LEXER_INT_INT16:
+      record.value.int16_value = (int16_t)value;
+      break;
+    case LEXER_INT_INT32:
+      record.value.int32_value = (int32_t)value;
+      break;
+    default:
+      record.value.int64_value = value;
+      break;
   }
+}
 
-  StringToken *token = new StringToken(this, current_lineno_, current_offset_, offset);
-  token->set_value(str);
+static void set_compact_number(LexerTokenRecord &record, uint64_t value)
+{
+  record.value_type = get_uint_type(value);
+  switch (record.value_type)
+  {
+    case LEXER_INT_UINT8:
+      record.value.uint8_value = (uint8_t)value;
+      break;
+    case LEXER_INT_UINT16:
+      record.value.uint16_value = (uint16_t)value;
+      break;
+    case LEXER_INT_UINT32:
+      record.value.uint32_value = (uint32_t)value;
+      break;
+    default:
+      record.value.uint64_value = value;
+      break;
+  }
+}
+
+static void set_compact_number(LexerTokenRecord &record, double value)
+{
+  record.value_type = get_floating_point_type(value);
+  if (record.value_type == LEXER_INT_FLOAT)
+  {
+    record.value.float_value = (float)value;
+  }
+  else
+  {
+    record.value.double_value = value;
+  }
+}
+
+bool Lexer::next(LexerTokenRecord &record)
+{
+  if (!skip_to_token())
+  {
+    return false;
+  }
+
+  int c = data_[position_];
+  if (c == '"' || c == '\'')
+  {
+    scan_string(record);
+  }
+  else if (is_name_char(c))
+  {
+    scan_name(record);
+  }
+  else
+  {
+    scan_number(record);
+  }
+
+  return true;
+}
+
+size_t Lexer::tokenize(std::vector<LexerTokenRecord> &records)
+{
+  size_t count = 0;
+  LexerTokenRecord record;
+  while (next(record))
+  {
+    records.push_back(record);
+    count++;
+  }
+
+  return count;
+}
+
+const NumberToken* Lexer::read_number()
+{
+  LexerTokenRecord record;
+  scan_number(record);
+
+  NumberToken *token = new NumberToken(this, record.lineno, record.begin_pos, record.end_pos);
+  switch (record.value_type)
+  {
+    case LEXER_INT_INT8:
+      token->set_value(record.value.int8_value);
+      break;
+    case LEXER_INT_UINT8:
+      token->set_value(record.value.uint8_value);
+      break;
+    case LEXER_INT_INT16:
+      token->set_value(record.value.int16_value);
+      break;
+    case LEXER_INT_UINT16:
+      token->set_value(record.value.uint16_value);
+      break;
+    case LEXER_INT_INT32:
+      token->set_value(record.value.int32_value);
+      break;
+    case LEXER_INT_UINT32:
+      token->set_value(record.value.uint32_value);
+      break;
+    case LEXER_INT_INT64:
+      token->set_value(record.value.int64_value);
+      break;
+    case LEXER_INT_UINT64:
+      token->set_value(record.value.uint64_value);
+      break;
+    case LEXER_INT_FLOAT:
+      token->set_value(record.value.float_value);
+      break;
+    default:
+      token->set_value(record.value.double_value);
+      break;
+  }
 
-  current_offset_ = offset;
   return token;
 }
 
-const NameToken* Lexer::read_name()
+const StringToken* Lexer::read_string()
 {
-  size_t offset = current_offset_;
-  int c = current_line_[offset];
-  std::string name;
+  LexerTokenRecord record;
+  scan_string(record);
 
-  do
+  // tokens own their text like they always have, so they outlive the
+  // lexer, records are the way to get views of the source instead
+  StringToken *token = new StringToken(this, record.lineno, record.begin_pos, record.end_pos);
+  if (record.has_escapes)
   {
-    name += c;
-    offset++;
-    c = current_line_[offset];
-  } while ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_');
+    token->set_value(decode_string(record));
+  }
+  else
+  {
+    token->set_value(record.get_view().to_string());
+  }
 
-  NameToken *token = new NameToken(this, current_lineno_, current_offset_, offset);
-  token->set_value(name);
+  return token;
+}
 
-  current_offset_ = offset;
+const NameToken* Lexer::read_name()
+{
+  LexerTokenRecord record;
+  scan_name(record);
+
+  NameToken *token = new NameToken(this, record.lineno, record.begin_pos, record.end_pos);
+  token->set_value(record.get_view().to_string());
   return token;
 }
 
 const LexerToken* Lexer::read()
 {
-  while (true)
+  if (!skip_to_token())
+  {
+    return nullptr;
+  }
+
+  int c = data_[position_];
+  if (c == '"' || c == '\'')
   {
-    auto it = current_line_.begin() + current_offset_;
-    if (it >= current_line_.end())
+    return read_string();
+  }
+  else if (is_name_char(c))
+  {
+    return read_name();
+  }
+
+  return read_number();
+}
+
+bool Lexer::skip_to_token()
+{
+  // the first line is only entered once there is something to read
+  if (!line_entered_ && position_ < size_)
+  {
+    line_entered_ = true;
+    current_lineno_++;
+  }
+
+  // moves to the first character of the next token, everything
+  // that cannot start a token is skipped over
+  while (position_ < size_)
+  {
+    position_ += find_run_end(data_ + position_, size_ - position_, LEXER_RUN_SPACE);
+    if (position_ >= size_)
     {
-      current_line_.clear();
-      if (!std::getline(stream_, current_line_))
-      {
-        return nullptr;
-      }
+      break;
+    }
 
+    int c = data_[position_];
+    if (c == '\n')
+    {
       current_lineno_++;
-      current_offset_ = 0;
+      line_begin_ = position_ + 1;
+    }
+    else if (c != '.' || (position_ + 1 < size_ && is_digit_char(data_[position_ + 1])))
+    {
+      return true;
     }
 
-    do
+    position_++;
+  }
+
+  return false;
+}
+
+void Lexer::scan_number(LexerTokenRecord &record)
+{
+  size_t begin = position_;
+  size_t offset = position_;
+  bool is_negative = false;
+  bool is_floating_point = false;
+
+  // check to see if this is a negative number
+  if (begin > line_begin_ && data_[begin - 1] == '-')
+  {
+    is_negative = true;
+    begin--;
+  }
+
+  if (data_[offset] == '.')
+  {
+    is_floating_point = true;
+  }
+
+  // a dot only continues the number when a digit follows it
+  offset++;
+  while (true)
+  {
+    offset += find_run_end(data_ + offset, size_ - offset, LEXER_RUN_DIGIT);
+    if (offset + 1 < size_ && data_[offset] == '.' && is_digit_char(data_[offset + 1]))
     {
-      it = current_line_.begin() + current_offset_;
-      int c = current_line_[current_offset_];
-      if ((c >= '0' && c <= '9') ||
-          (c == '.' && current_line_[current_offset_ + 1] >= '0' &&
-          (c == '.' && current_line_[current_offset_ + 1] <= '9')))
-      {
-        return read_number();
-      }
-      else if (c == '\"' || c == '\'')
-      {
-        return read_string();
-      }
-      else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+      is_floating_point = true;
+      offset++;
+      continue;
+    }
+
+    break;
+  }
+
+  record.type = LEXER_TOKEN_NUMBER;
+  record.is_negative = is_negative;
+  record.is_floating_point = is_floating_point;
+  record.has_escapes = false;
+  record.lineno = current_lineno_;
+  record.begin_pos = position_ - line_begin_;
+  record.end_pos = offset - line_begin_;
+  record.data = data_ + begin;
+  record.size = offset - begin;
+
+  // the conversion functions need a terminated string, the number's
+  // text is copied onto the stack unless it is unusually long
+  char number_data[64];
+  std::string number_str;
+  const char *number = number_data;
+  if (record.size < sizeof(number_data))
+  {
+    memcpy(number_data, record.data, record.size);
+    number_data[record.size] = '\0';
+  }
+  else
+  {
+    number_str.assign(record.data, record.size);
+    number = number_str.c_str();
+  }
+
+  // the whole text must convert, a second dot or a digit that is not
+  // valid in the base of the number is malformed rather than ignored
+  char *end = nullptr;
+  errno = 0;
+  if (is_floating_point)
+  {
+    set_compact_number(record, strtod(number, &end));
+  }
+  else if (is_negative)
+  {
+    set_compact_number(record, (int64_t)strtoll(number, &end, 10));
+  }
+  else
+  {
+    set_compact_number(record, (uint64_t)strtoull(number, &end, 10));
+  }
+
+  if (end != number + record.size)
+  {
+    throw std::runtime_error(StringFormatter() << "Malformed number on line: " << current_lineno_ << " at offset: " << record.begin_pos);
+  }
+  else if (errno == ERANGE)
+  {
+    throw std::runtime_error(StringFormatter() << "Number out of range on line: " << current_lineno_ << " at offset: " << record.begin_pos);
+  }
+
+  position_ = offset;
+}
+
+void Lexer::scan_string(LexerTokenRecord &record)
+{
+  char quote = data_[position_];
+  uint8_t run = quote == '"' ? LEXER_RUN_DOUBLE_QUOTED : LEXER_RUN_SINGLE_QUOTED;
+  size_t offset = position_;
+  offset++; // skip over the first quote
+
+  // a string ends at the next matching quote on the same line, the
+  // escape sequences are only checked here and decoded on request
+  size_t begin = offset;
+  bool has_escapes = false;
+  while (true)
+  {
+    offset += find_run_end(data_ + offset, size_ - offset, run);
+    if (offset >= size_ || data_[offset] == '\n')
+    {
+      throw std::runtime_error(StringFormatter() << "Unterminated string on line: " << current_lineno_ << " at offset: " << position_ - line_begin_);
+    }
+    else if (data_[offset] == quote)
+    {
+      break;
+    }
+
+    has_escapes = true;
+    offset += get_escape_size(offset);
+  }
+
+  record.type = LEXER_TOKEN_STRING;
+  record.value_type = 0;
+  record.is_negative = false;
+  record.is_floating_point = false;
+  record.has_escapes = has_escapes;
+  record.lineno = current_lineno_;
+  record.begin_pos = position_ - line_begin_;
+  record.end_pos = offset - line_begin_;
+  record.data = data_ + begin;
+  record.size = offset - begin;
+  record.value.uint64_value = 0;
+
+  // skip over the closing quote
+  position_ = offset + 1;
+}
+
+size_t Lexer::get_escape_size(size_t offset) const
+{
+  // the backslash is the last character of the line
+  if (offset + 1 >= size_ || data_[offset + 1] == '\n')
+  {
+    throw std::runtime_error(StringFormatter() << "Unterminated string on line: " << current_lineno_ << " at offset: " << position_ - line_begin_);
+  }
+
+  switch (data_[offset + 1])
+  {
+    case 'n':
+    case 't':
+    case 'r':
+    case '0':
+    case '\\':
+    case '"':
+    case '\'':
+      return 2;
+    case 'x':
+      if (offset + 3 < size_ && get_hex_value(data_[offset + 2]) >= 0 && get_hex_value(data_[offset + 3]) >= 0)
       {
-        return read_name();
+        return 4;
       }
 
-      current_offset_++;
-    } while (it < current_line_.end());
+      break;
+    default:
+      break;
   }
 
-  return nullptr;
+  throw std::runtime_error(StringFormatter() << "Invalid escape sequence on line: " << current_lineno_ << " at offset: " << offset - line_begin_);
+}
+
+std::string Lexer::decode_string(const LexerTokenRecord &record)
+{
+  std::string value;
+  value.reserve(record.size);
+
+  const char *data = record.data;
+  const char *end = record.data + record.size;
+  while (data < end)
+  {
+    // copy everything up to the next escape sequence at once
+    const char *escape = (const char*)memchr(data, '\\', end - data);
+    if (escape == nullptr)
+    {
+      value.append(data, end - data);
+      break;
+    }
+
+    value.append(data, escape - data);
+    if (escape + 1 >= end)
+    {
+      throw std::runtime_error("Failed to decode string, it ends with a backslash!");
+    }
+
+    data = escape + 2;
+    switch (escape[1])
+    {
+      case 'n':
+        value += '\n';
+        break;
+      case 't':
+        value += '\t';
+        break;
+      case 'r':
+        value += '\r';
+        break;
+      case '0':
+        value += '\0';
+        break;
+      case 'x':
+        if (escape + 3 >= end || get_hex_value(escape[2]) < 0 || get_hex_value(escape[3]) < 0)
+        {
+          throw std::runtime_error("Failed to decode string, invalid hex escape sequence!");
+        }
+
+        value += (char)(get_hex_value(escape[2]) << 4 | get_hex_value(escape[3]));
+        data = escape + 4;
+        break;
+      default:
+        value += escape[1];
+        break;
+    }
+  }
+
+  return value;
+}
+
+void Lexer::scan_name(LexerTokenRecord &record)
+{
+  size_t offset = position_ + 1;
+  offset += find_run_end(data_ + offset, size_ - offset, LEXER_RUN_NAME);
+
+  record.type = LEXER_TOKEN_NAME;
+  record.value_type = 0;
+  record.is_negative = false;
+  record.is_floating_point = false;
+  record.has_escapes = false;
+  record.lineno = current_lineno_;
+  record.begin_pos = position_ - line_begin_;
+  record.end_pos = offset - line_begin_;
+  record.data = data_ + position_;
+  record.size = offset - position_;
+  record.value.uint64_value = 0;
+
+  position_ = offset;
 }
@@ -37,8 +37,10 @@
 #include <string>
 #include <sstream>
 #include <limits>
+#include <vector>
 
 #include "utils.hpp"
+#include "buffer.hpp"
 
 typedef enum : uint8_t
 {
@@ -113,11 +115,12 @@ inline uint8_t get_uint_type(uint64_t value)
 
 inline uint8_t get_floating_point_type(double value)
 {
-  if (value >= std::numeric_limits<float>::min() && value <= std::numeric_limits<float>::max())
+  // min() is the smallest positive value, the range starts at lowest()
+  if (value >= std::numeric_limits<float>::lowest() && value <= std::numeric_limits<float>::max())
   {
     return LEXER_INT_FLOAT;
   }
-  else if (value >= std::numeric_limits<double>::min() && value <= std::numeric_limits<double>::max())
+  else if (value >= std::numeric_limits<double>::lowest() && value <= std::numeric_limits<double>::max())
   {
     return LEXER_INT_DOUBLE;
   }
@@ -125,6 +128,46 @@ inline uint8_t get_floating_point_type(double value)
   throw std::runtime_error("Failed to get floating point integer type!");
 }
 
+// the value of a number token, which member is set is given by its
+// LexerIntegerTypes value type
+union LexerNumberValue
+{
+  int8_t int8_value;
+  uint8_t uint8_value;
+
+  int16_t int16_value;
+  uint16_t uint16_value;
+
+  int32_t int32_value;
+  uint32_t uint32_value;
+
+  int64_t int64_value;
+  uint64_t uint64_value;
+
+  float float_value;
+  double double_value;
+};
+
+// a token by value, it holds no resources of its own, so tokens can be kept
+// in a plain vector and are never allocated one at a time. the text is a
+// view into the lexer's source and positions are relative to the line
+struct LexerTokenRecord
+{
+  uint8_t type;
+  uint8_t value_type;
+  bool is_negative;
+  bool is_floating_point;
+  bool has_escapes;
+  size_t lineno;
+  size_t begin_pos;
+  size_t end_pos;
+  const char *data;
+  size_t size;
+  LexerNumberValue value;
+
+  BufferView get_view() const { return BufferView((const uint8_t*)data, size); }
+};
+
 class Lexer;
 
 class StringToken;
@@ -183,8 +226,18 @@ public:
   void set_value(std::string value);
   std::string get_value() const;
 
+  // the token text as a view into the lexer's source, it is only valid
+  // for as long as the source is, get_value() makes a copy of it. a token
+  // given its own value views that instead, so copies stay valid
+  void set_view(BufferView view);
+  BufferView get_view() const;
+
+  bool owns_value() const;
+
 protected:
   std::string value_ = "";
+  BufferView view_;
+  bool owns_value_ = false;
 };
 
 class LiteralToken : public StringToken
@@ -258,7 +311,7 @@ public:
 private:
   bool is_negative_ = false;
   bool is_floating_point_ = false;
-  uint8_t *value_ = nullptr;
+  LexerNumberValue value_ = {};
   uint8_t value_type_ = 0;
 };
 
@@ -284,9 +337,16 @@ public:
   const PunctuationToken* as_punctuation_token() const;
 };
 
+// lexes a contiguous source in place, tokens refer to the source through
+// views and nothing is copied per line or per character. the source must
+// outlive the lexer and its tokens, except for a stream which is read once
+// into storage the lexer owns. positions are relative to the current line,
+// the line number is 0 until the first read enters the first line
 class Lexer
 {
 public:
+  Lexer(const char *data, size_t size);
+  Lexer(const Buffer *buffer);
   Lexer(std::istringstream &stream);
   virtual ~Lexer();
 
@@ -299,16 +359,37 @@ public:
   void set_current_offset(size_t current_offset);
   size_t get_current_offset();
 
+  // reads the next token into the record, returns false at the end
+  // of the source. tokenize() appends every remaining token instead
+  bool next(LexerTokenRecord &record);
+  size_t tokenize(std::vector<LexerTokenRecord> &records);
+
+  // the heap allocated tokens, kept for callers of the class hierarchy
   virtual const NumberToken* read_number();
   virtual const StringToken* read_string();
   virtual const NameToken* read_name();
   virtual const LexerToken* read();
 
+  // decodes the escape sequences of a string record, a record without
+  // escapes can use its view of the source instead
+  static std::string decode_string(const LexerTokenRecord &record);
+
 protected:
-  std::istringstream &stream_;
-  std::string current_line_ = "";
+  bool skip_to_token();
+  size_t get_line_end() const;
+
+  void scan_number(LexerTokenRecord &record);
+  void scan_string(LexerTokenRecord &record);
+  size_t get_escape_size(size_t offset) const;
+  void scan_name(LexerTokenRecord &record);
+
+  std::string source_ = "";
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  size_t position_ = 0;
+  size_t line_begin_ = 0;
   size_t current_lineno_ = 0;
-  size_t current_offset_ = 0;
+  bool line_entered_ = false;
 };
 
 #endif // _LEXER_H
@@ -0,0 +1,282 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mapped_buffer.hpp"
+
+// the smallest step a writable mapping grows by, growing the file and the
+// mapping is expensive so it is done rarely and in large increments
+static const size_t MAPPED_BUFFER_MIN_GROWTH = 4 * 1024 * 1024;
+
+static size_t round_to_page_size(size_t size)
+{
+  static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+MappedBuffer::MappedBuffer(const std::string &path, uint8_t mode) : MappedBuffer()
+{
+  open(path, mode);
+}
+
+MappedBuffer::MappedBuffer() : Buffer()
+{
+
+}
+
+MappedBuffer::~MappedBuffer()
+{
+  // a destructor must not throw, call close() directly to see errors
+  try
+  {
+    close();
+  }
+  catch (const std::runtime_error&)
+  {
+
+  }
+}
+
+void MappedBuffer::open(const std::string &path, uint8_t mode)
+{
+  close();
+
+  if (mode == MAPPED_BUFFER_READ)
+  {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+  }
+  else if (mode == MAPPED_BUFFER_WRITE)
+  {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  }
+  else
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot open mapped file with unknown mode: " << (uint32_t)mode);
+  }
+
+  if (fd_ < 0)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to open mapped file: " << path << ", " << strerror(errno));
+  }
+
+  mode_ = mode;
+  if (mode == MAPPED_BUFFER_WRITE)
+  {
+    return;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd_, &file_stat) != 0)
+  {
+    int error = errno;
+    close();
+    throw std::runtime_error(StringFormatter() << "Failed to stat mapped file: " << path << ", " << strerror(error));
+  }
+
+  size_t file_size = (size_t)file_stat.st_size;
+  if (file_size == 0)
+  {
+    return;
+  }
+
+  void *map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (map == MAP_FAILED)
+  {
+    int error = errno;
+    close();
+    throw std::runtime_error(StringFormatter() << "Failed to map file: " << path << ", " << strerror(error));
+  }
+
+  map_ = (uint8_t*)map;
+  map_size_ = file_size;
+  madvise(map_, map_size_, MADV_SEQUENTIAL);
+  set_borrowed_data(map_, map_size_);
+}
+
+void MappedBuffer::close()
+{
+  if (fd_ < 0)
+  {
+    return;
+  }
+
+  size_t size = size_;
+  clear();
+
+  if (map_ != nullptr)
+  {
+    munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+  }
+
+  // drop the unused tail the mapping grew into
+  if (mode_ == MAPPED_BUFFER_WRITE && ftruncate(fd_, (off_t)size) != 0)
+  {
+    int error = errno;
+    ::close(fd_);
+    fd_ = -1;
+    throw std::runtime_error(StringFormatter() << "Failed to truncate mapped file with size: " << size << ", " << strerror(error));
+  }
+
+  ::close(fd_);
+  fd_ = -1;
+}
+
+void MappedBuffer::sync()
+{
+  if (mode_ != MAPPED_BUFFER_WRITE || map_ == nullptr || size_ == 0)
+  {
+    return;
+  }
+
+  if (msync(map_, round_to_page_size(size_), MS_SYNC) != 0)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to sync mapped file, " << strerror(errno));
+  }
+}
+
+bool MappedBuffer::has_external_storage() const
+{
+  // a read mapping looks like borrowed data, but it is unmapped when this
+  // buffer closes, so it must be copied out rather than handed over
+  return map_ != nullptr && data_ == map_;
+}
+
+bool MappedBuffer::is_open() const
+{
+  return fd_ >= 0;
+}
+
+uint8_t MappedBuffer::get_mode() const
+{
+  return mode_;
+}
+
+void MappedBuffer::reserve(size_t capacity)
+{
+  if (mode_ != MAPPED_BUFFER_WRITE)
+  {
+    Buffer::reserve(capacity);
+    return;
+  }
+
+  if (capacity <= capacity_)
+  {
+    return;
+  }
+
+  remap(round_to_page_size(capacity));
+}
+
+void MappedBuffer::shrink_to_fit()
+{
+  if (mode_ != MAPPED_BUFFER_WRITE)
+  {
+    Buffer::shrink_to_fit();
+    return;
+  }
+
+  size_t map_size = round_to_page_size(size_);
+  if (map_size < map_size_ && map_size > 0)
+  {
+    remap(map_size);
+  }
+}
+
+void MappedBuffer::grow(size_t size)
+{
+  if (mode_ != MAPPED_BUFFER_WRITE)
+  {
+    Buffer::grow(size);
+    return;
+  }
+
+  if (fd_ < 0)
+  {
+    throw std::runtime_error("Cannot write to a MappedBuffer that is not open!");
+  }
+
+  size_t required_capacity = offset_ + size;
+  size_t capacity = capacity_ * 2;
+  if (capacity < MAPPED_BUFFER_MIN_GROWTH)
+  {
+    capacity = MAPPED_BUFFER_MIN_GROWTH;
+  }
+
+  if (capacity < required_capacity)
+  {
+    capacity = required_capacity;
+  }
+
+  reserve(capacity);
+}
+
+void MappedBuffer::remap(size_t map_size)
+{
+  // the file has to cover the whole mapping before it can be touched
+  if (ftruncate(fd_, (off_t)map_size) != 0)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to resize mapped file with size: " << map_size << ", " << strerror(errno));
+  }
+
+  void *map = MAP_FAILED;
+  if (map_ == nullptr)
+  {
+    map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  }
+  else
+  {
+#ifdef __linux__
+    map = mremap(map_, map_size_, map_size, MREMAP_MAYMOVE);
+#else
+    munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+#endif
+  }
+
+  if (map == MAP_FAILED)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to map file with size: " << map_size << ", " << strerror(errno));
+  }
+
+  map_ = (uint8_t*)map;
+  map_size_ = map_size;
+  madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+  // the mapping is not ours to free, so the buffer treats it as borrowed
+  // storage, but unlike a borrowed buffer all of it may be written to
+  data_ = map_;
+  capacity_ = map_size_;
+  owns_data_ = false;
+}
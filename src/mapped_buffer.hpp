@@ -0,0 +1,76 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _MAPPED_BUFFER_H
+#define _MAPPED_BUFFER_H
+
+#include <cstdlib>
+#include <cstdint>
+
+#include <string>
+
+#include "buffer.hpp"
+
+typedef enum : uint8_t
+{
+  MAPPED_BUFFER_READ = 0,
+  MAPPED_BUFFER_WRITE
+} MappedBufferModes;
+
+// a buffer backed by a memory mapped file. in read mode the file is mapped
+// read only and decoded in place, a write moves the data into the heap the
+// same way a borrowed buffer does. in write mode the file is created or
+// truncated and grows with the buffer, it is cut to the written size on close
+class MappedBuffer : public Buffer
+{
+public:
+  MappedBuffer(const std::string &path, uint8_t mode);
+  MappedBuffer();
+  ~MappedBuffer();
+
+  void open(const std::string &path, uint8_t mode);
+  void close();
+  void sync();
+
+  bool is_open() const;
+  uint8_t get_mode() const;
+
+  void reserve(size_t capacity);
+  void shrink_to_fit();
+
+protected:
+  void grow(size_t size);
+  bool has_external_storage() const;
+
+private:
+  void remap(size_t map_size);
+
+  int fd_ = -1;
+  uint8_t mode_ = MAPPED_BUFFER_READ;
+  uint8_t *map_ = nullptr;
+  size_t map_size_ = 0;
+};
+
+#endif // _MAPPED_BUFFER_H
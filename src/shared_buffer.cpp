@@ -0,0 +1,250 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include "chained_buffer.hpp"
+#include "shared_buffer.hpp"
+
+SharedBuffer::SharedBuffer(Buffer &&buffer)
+{
+  size_t size = buffer.get_size();
+  if (size == 0)
+  {
+    if (!buffer.is_borrowed())
+    {
+      buffer.clear();
+    }
+
+    return;
+  }
+
+  if (buffer.is_borrowed())
+  {
+    // the storage belongs to someone else, a caller, an inline array or a
+    // mapped file, so the frozen copy gets its own and the buffer is left
+    // alone. clearing it would truncate a file that is still being written
+    allocate(buffer.get_allocator(), size);
+    memcpy(block_->data, buffer.get_data(), size);
+  }
+  else
+  {
+    block_ = new SharedBufferBlock();
+    block_->count = 1;
+    block_->allocator = buffer.get_allocator();
+    block_->capacity = buffer.get_capacity();
+    block_->data = buffer.release();
+  }
+
+  buffer_.set_borrowed_data(block_->data, size);
+}
+
+SharedBuffer::SharedBuffer(ChainedBuffer &&chain)
+{
+  size_t size = chain.get_total_size();
+  if (size > 0)
+  {
+    // the segments are joined into one block, so the frozen buffer
+    // is contiguous like any other
+    allocate(chain.get_allocator(), size);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < chain.get_segment_count(); i++)
+    {
+      BufferView segment = chain.get_segment(i);
+      if (!segment.is_empty())
+      {
+        memcpy(block_->data + offset, segment.get_data(), segment.get_size());
+        offset += segment.get_size();
+      }
+    }
+
+    buffer_.set_borrowed_data(block_->data, size);
+  }
+
+  chain.clear();
+}
+
+SharedBuffer::SharedBuffer(SharedBufferBlock *block, const uint8_t *data, size_t size)
+  : block_(block)
+{
+  retain();
+  buffer_.set_borrowed_data(data, size);
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer &other)
+  : SharedBuffer(other.block_, other.get_data(), other.get_size())
+{
+
+}
+
+SharedBuffer::SharedBuffer(SharedBuffer &&other)
+  : block_(other.block_)
+{
+  buffer_.set_borrowed_data(other.get_data(), other.get_size());
+  other.block_ = nullptr;
+  other.buffer_.clear();
+}
+
+SharedBuffer::SharedBuffer()
+{
+
+}
+
+SharedBuffer::~SharedBuffer()
+{
+  release();
+}
+
+SharedBuffer& SharedBuffer::operator = (const SharedBuffer &other)
+{
+  if (this != &other)
+  {
+    // take the new reference first, the other buffer may be a slice of ours
+    SharedBufferBlock *block = other.block_;
+    const uint8_t *data = other.get_data();
+    size_t size = other.get_size();
+    if (block != nullptr)
+    {
+      block->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    release();
+    block_ = block;
+    buffer_.set_borrowed_data(data, size);
+  }
+
+  return *this;
+}
+
+SharedBuffer& SharedBuffer::operator = (SharedBuffer &&other)
+{
+  if (this != &other)
+  {
+    release();
+    block_ = other.block_;
+    buffer_.set_borrowed_data(other.get_data(), other.get_size());
+    other.block_ = nullptr;
+    other.buffer_.clear();
+  }
+
+  return *this;
+}
+
+void SharedBuffer::clear()
+{
+  release();
+  block_ = nullptr;
+  buffer_.clear();
+}
+
+const uint8_t* SharedBuffer::get_data() const
+{
+  return buffer_.get_data();
+}
+
+size_t SharedBuffer::get_size() const
+{
+  return buffer_.get_size();
+}
+
+bool SharedBuffer::is_empty() const
+{
+  return buffer_.get_size() == 0;
+}
+
+size_t SharedBuffer::get_use_count() const
+{
+  if (block_ == nullptr)
+  {
+    return 0;
+  }
+
+  return block_->count.load(std::memory_order_relaxed);
+}
+
+SharedBuffer SharedBuffer::slice(size_t offset, size_t size) const
+{
+  if (offset > get_size() || size > get_size() - offset)
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot slice SharedBuffer at offset: " << offset << " with size: " << size << ", buffer size: " << get_size());
+  }
+
+  if (size == 0)
+  {
+    return SharedBuffer();
+  }
+
+  return SharedBuffer(block_, get_data() + offset, size);
+}
+
+BufferView SharedBuffer::get_view() const
+{
+  return BufferView(get_data(), get_size());
+}
+
+const Buffer* SharedBuffer::get_buffer() const
+{
+  return &buffer_;
+}
+
+void SharedBuffer::allocate(BufferAllocator *allocator, size_t size)
+{
+  uint8_t *data = allocator->allocate(size);
+  if (data == nullptr)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to freeze buffer with size: " << size);
+  }
+
+  block_ = new SharedBufferBlock();
+  block_->count = 1;
+  block_->data = data;
+  block_->capacity = size;
+  block_->allocator = allocator;
+}
+
+void SharedBuffer::retain()
+{
+  if (block_ != nullptr)
+  {
+    block_->count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void SharedBuffer::release()
+{
+  if (block_ == nullptr)
+  {
+    return;
+  }
+
+  // the last reference frees the data, the ordering keeps reads made
+  // through the other references on other threads from passing the free
+  if (block_->count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    block_->allocator->deallocate(block_->data, block_->capacity);
+    delete block_;
+  }
+
+  block_ = nullptr;
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _SHARED_BUFFER_H
+#define _SHARED_BUFFER_H
+
+#include <cstdlib>
+#include <cstdint>
+
+#include <atomic>
+
+#include "buffer.hpp"
+
+class ChainedBuffer;
+
+// the storage shared by every copy and slice of a frozen buffer
+struct SharedBufferBlock
+{
+  std::atomic<size_t> count;
+  uint8_t *data;
+  size_t capacity;
+  BufferAllocator *allocator;
+};
+
+// an immutable, reference counted buffer. freezing a buffer takes over its
+// storage, after which copies and slices of it only take a reference, so
+// one encoded message can be handed to many readers without copying it.
+// the count is atomic and copies may live on different threads, but the
+// last one to go frees the data through the frozen buffer's allocator.
+// a buffer whose storage it does not own, such as borrowed data, an
+// InlineBuffer or a MappedBuffer, is copied and left as it was, and a
+// chained buffer is joined into a single block
+class SharedBuffer
+{
+public:
+  SharedBuffer(Buffer &&buffer);
+  SharedBuffer(ChainedBuffer &&chain);
+  SharedBuffer(const SharedBuffer &other);
+  SharedBuffer(SharedBuffer &&other);
+  SharedBuffer();
+  ~SharedBuffer();
+
+  SharedBuffer& operator = (const SharedBuffer &other);
+  SharedBuffer& operator = (SharedBuffer &&other);
+
+  void clear();
+
+  const uint8_t* get_data() const;
+  size_t get_size() const;
+  bool is_empty() const;
+
+  size_t get_use_count() const;
+
+  SharedBuffer slice(size_t offset, size_t size) const;
+  BufferView get_view() const;
+
+  // a borrowed buffer over the shared bytes, for use with a BufferIterator
+  const Buffer* get_buffer() const;
+
+private:
+  SharedBuffer(SharedBufferBlock *block, const uint8_t *data, size_t size);
+
+  void allocate(BufferAllocator *allocator, size_t size);
+
+  void retain();
+  void release();
+
+  SharedBufferBlock *block_ = nullptr;
+  Buffer buffer_;
+};
+
+#endif // _SHARED_BUFFER_H
@@ -0,0 +1,186 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _SIZING_BUFFER_H
+#define _SIZING_BUFFER_H
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+
+#include <limits>
+#include <string>
+
+#include "buffer.hpp"
+
+// a sink with the same write methods as Buffer that only counts the bytes
+// an encode would produce, down to the size tag picked by write_string and
+// the width of every varint. encode functions templated on their sink can
+// run against it first, so the real encode reserves once and never grows
+class SizingBuffer
+{
+public:
+  void clear() { size_ = 0; }
+
+  size_t get_size() const { return size_; }
+  size_t get_offset() const { return size_; }
+
+  void write(const uint8_t *data, size_t size) { size_ += size; }
+  void pad(size_t size) { size_ += size; }
+
+  template <typename Type>
+  void write(Type value);
+
+  void write_uint8(uint8_t value) { size_ += 1; }
+  void write_int8(int8_t value) { size_ += 1; }
+
+  void write_uint16(uint16_t value) { size_ += 2; }
+  void write_int16(int16_t value) { size_ += 2; }
+
+  void write_uint32(uint32_t value) { size_ += 4; }
+  void write_int32(int32_t value) { size_ += 4; }
+
+  void write_uint64(uint64_t value) { size_ += 8; }
+  void write_int64(int64_t value) { size_ += 8; }
+
+  void write_float32(float value) { size_ += 4; }
+  void write_float64(double value) { size_ += 8; }
+
+  void write_varuint32(uint32_t value) { size_ += get_varuint_size(value); }
+  void write_varint32(int32_t value) { size_ += get_varuint_size(zigzag_encode32(value)); }
+
+  void write_varuint64(uint64_t value) { size_ += get_varuint_size(value); }
+  void write_varint64(int64_t value) { size_ += get_varuint_size(zigzag_encode64(value)); }
+
+  void write_varuint32_array(const uint32_t *values, size_t count);
+
+  void write_string8(const char *string, uint8_t size) { size_ += 1 + size; }
+  void write_string8(const std::string &str) { write_string8(str.c_str(), str.size()); }
+
+  void write_string16(const char *string, uint16_t size) { size_ += 2 + size; }
+  void write_string16(const std::string &str) { write_string16(str.c_str(), str.size()); }
+
+  void write_string32(const char *string, uint32_t size) { size_ += 4 + size; }
+  void write_string32(const std::string &str) { write_string32(str.c_str(), str.size()); }
+
+  void write_string64(const char *string, uint64_t size) { size_ += 8 + size; }
+  void write_string64(const std::string &str) { write_string64(str.c_str(), str.size()); }
+
+  void write_string(const char *string, size_t size);
+  void write_string(const std::string &str) { write_string(str.c_str(), str.size()); }
+
+  void write_padded_string(const char *string, size_t size, size_t padded_size);
+  void write_padded_string(const std::string &str, size_t padded_size) { write_padded_string(str.c_str(), str.size(), padded_size); }
+
+  template <typename Type>
+  void write_array(const Type *values, size_t count) { size_ += count * sizeof(Type); }
+
+  template <typename... Types>
+  void write_fields(Types... values) { size_ += BufferFieldsSize<Types...>::value; }
+
+  template <BufferByteOrder Order, typename Type>
+  void write_ordered(Type value) { size_ += sizeof(Type); }
+
+  template <BufferByteOrder Order, typename Type>
+  void write_ordered_array(const Type *values, size_t count) { size_ += count * sizeof(Type); }
+
+  template <typename Type>
+  BufferSlot<Type> reserve_slot();
+
+  template <typename Type>
+  void patch(BufferSlot<Type> slot, Type value) {}
+
+  BufferMark mark() const;
+  void rewind(BufferMark mark) { size_ = mark.size; }
+
+private:
+  size_t size_ = 0;
+};
+
+template <typename Type>
+inline void SizingBuffer::write(Type value)
+{
+  static_assert(BufferValueTraits<Type>::is_value, "Only fixed width values can be written!");
+  size_ += sizeof(Type);
+}
+
+inline void SizingBuffer::write_varuint32_array(const uint32_t *values, size_t count)
+{
+  if (count > 0)
+  {
+    size_ += get_stream_vbyte_size(values, count);
+  }
+}
+
+// the same size tags that Buffer::write_string picks
+inline void SizingBuffer::write_string(const char *string, size_t size)
+{
+  assert(size > 0);
+  if (size <= std::numeric_limits<uint8_t>::max())
+  {
+    size_ += 1 + 1 + size;
+  }
+  else if (size <= std::numeric_limits<uint16_t>::max())
+  {
+    size_ += 1 + 2 + size;
+  }
+  else if (size <= std::numeric_limits<uint32_t>::max())
+  {
+    size_ += 1 + 4 + size;
+  }
+  else
+  {
+    size_ += 1 + 8 + size;
+  }
+}
+
+inline void SizingBuffer::write_padded_string(const char *string, size_t size, size_t padded_size)
+{
+  assert(size > 0);
+  assert(padded_size > 0);
+  if (size > padded_size)
+  {
+    throw std::runtime_error(StringFormatter() << "Cannot write padded string, string size: " << size << " exceeds padded size: " << padded_size);
+  }
+
+  size_ += padded_size;
+}
+
+template <typename Type>
+inline BufferSlot<Type> SizingBuffer::reserve_slot()
+{
+  static_assert(BufferValueTraits<Type>::is_value, "Only fixed width values can be reserved!");
+  BufferSlot<Type> slot = { size_, 0 };
+  size_ += sizeof(Type);
+  return slot;
+}
+
+inline BufferMark SizingBuffer::mark() const
+{
+  BufferMark mark = { size_, size_, 0 };
+  return mark;
+}
+
+#endif // _SIZING_BUFFER_H
@@ -0,0 +1,294 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cerrno>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "stream.hpp"
+
+static const size_t STREAM_DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+// writes every byte described by the vectors, retrying partial writes
+static void write_all(int fd, struct iovec *vectors, int count)
+{
+  while (count > 0)
+  {
+    ssize_t written = writev(fd, vectors, count);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      throw std::runtime_error(StringFormatter() << "Failed to write to stream, " << strerror(errno));
+    }
+
+    size_t remaining = (size_t)written;
+    while (count > 0 && remaining >= vectors->iov_len)
+    {
+      remaining -= vectors->iov_len;
+      vectors++;
+      count--;
+    }
+
+    if (count > 0)
+    {
+      vectors->iov_base = (uint8_t*)vectors->iov_base + remaining;
+      vectors->iov_len -= remaining;
+    }
+  }
+}
+
+StreamWriter::StreamWriter(int fd, size_t block_size)
+  : Buffer(), fd_(fd), block_size_(block_size)
+{
+  assert(fd >= 0);
+  assert(block_size > 0);
+  reserve(block_size);
+}
+
+StreamWriter::StreamWriter(int fd) : StreamWriter(fd, STREAM_DEFAULT_BLOCK_SIZE)
+{
+
+}
+
+StreamWriter::~StreamWriter()
+{
+  // a destructor must not throw, call flush() directly to see errors
+  try
+  {
+    flush();
+  }
+  catch (const std::runtime_error&)
+  {
+
+  }
+}
+
+int StreamWriter::get_fd() const
+{
+  return fd_;
+}
+
+size_t StreamWriter::get_block_size() const
+{
+  return block_size_;
+}
+
+size_t StreamWriter::get_flushed_size() const
+{
+  return flushed_size_;
+}
+
+void StreamWriter::flush()
+{
+  write_vectors(nullptr, 0);
+}
+
+void StreamWriter::write(const uint8_t *data, size_t size)
+{
+  assert(data != nullptr);
+  assert(size > 0);
+
+  if (offset_ + size <= capacity_)
+  {
+    Buffer::write(data, size);
+  }
+  else if (size < capacity_)
+  {
+    flush();
+    Buffer::write(data, size);
+  }
+  else
+  {
+    write_vectors(data, size);
+  }
+}
+
+void StreamWriter::pad(size_t size)
+{
+  assert(size > 0);
+  while (size > 0)
+  {
+    if (offset_ == capacity_)
+    {
+      flush();
+    }
+
+    size_t padding_size = std::min(size, capacity_ - offset_);
+    Buffer::pad(padding_size);
+    size -= padding_size;
+  }
+}
+
+void StreamWriter::grow(size_t size)
+{
+  flush();
+
+  // only a single value larger than the whole block makes it grow
+  if (offset_ + size > capacity_)
+  {
+    Buffer::grow(size);
+  }
+}
+
+void StreamWriter::write_vectors(const uint8_t *data, size_t size)
+{
+  struct iovec vectors[2];
+  int count = 0;
+
+  if (size_ > 0)
+  {
+    vectors[count].iov_base = data_;
+    vectors[count].iov_len = size_;
+    count++;
+  }
+
+  if (size > 0)
+  {
+    vectors[count].iov_base = (void*)data;
+    vectors[count].iov_len = size;
+    count++;
+  }
+
+  write_all(fd_, vectors, count);
+  if (size_ > 0)
+  {
+    invalidate_marks();
+  }
+
+  flushed_size_ += size_ + size;
+  size_ = 0;
+  offset_ = 0;
+}
+
+StreamReader::StreamReader(int fd, size_t window_size)
+  : BufferIterator(), fd_(fd), window_capacity_(window_size)
+{
+  assert(fd >= 0);
+  assert(window_size > 0);
+
+  window_data_ = (uint8_t*)malloc(window_size);
+  if (window_data_ == nullptr)
+  {
+    throw std::runtime_error(StringFormatter() << "Failed to allocate stream window with size: " << window_size);
+  }
+
+  window_.set_borrowed_data(window_data_, 0);
+  set_buffer(&window_);
+}
+
+StreamReader::StreamReader(int fd) : StreamReader(fd, STREAM_DEFAULT_BLOCK_SIZE)
+{
+
+}
+
+StreamReader::~StreamReader()
+{
+  window_.clear();
+  free(window_data_);
+  window_data_ = nullptr;
+}
+
+int StreamReader::get_fd() const
+{
+  return fd_;
+}
+
+size_t StreamReader::get_window_size() const
+{
+  return window_capacity_;
+}
+
+size_t StreamReader::get_position() const
+{
+  return window_position_ + offset_;
+}
+
+bool StreamReader::is_eof()
+{
+  return get_remaining_size() == 0 && !fill(1);
+}
+
+bool StreamReader::fill(size_t size)
+{
+  // move the unread bytes to the front of the window
+  size_t remaining_size = window_size_ - offset_;
+  if (offset_ > 0 && remaining_size > 0)
+  {
+    memmove(window_data_, window_data_ + offset_, remaining_size);
+  }
+
+  window_position_ += offset_;
+  window_size_ = remaining_size;
+  offset_ = 0;
+
+  if (size > window_capacity_)
+  {
+    uint8_t *window_data = (uint8_t*)realloc(window_data_, size);
+    if (window_data == nullptr)
+    {
+      throw std::runtime_error(StringFormatter() << "Failed to grow stream window with size: " << size);
+    }
+
+    window_data_ = window_data;
+    window_capacity_ = size;
+  }
+
+  // read as much as fits, a full window means fewer refills later
+  while (window_size_ < size && !eof_)
+  {
+    ssize_t read_size = ::read(fd_, window_data_ + window_size_, window_capacity_ - window_size_);
+    if (read_size < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+
+      // a non-blocking descriptor has nothing more for now, the read
+      // fails and can be retried once more bytes have arrived
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        break;
+      }
+
+      throw std::runtime_error(StringFormatter() << "Failed to read from stream, " << strerror(errno));
+    }
+    else if (read_size == 0)
+    {
+      eof_ = true;
+    }
+
+    window_size_ += (size_t)read_size;
+  }
+
+  window_.set_borrowed_data(window_data_, window_size_);
+  return window_size_ >= size;
+}
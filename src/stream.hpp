@@ -0,0 +1,96 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _STREAM_H
+#define _STREAM_H
+
+#include <cstdlib>
+#include <cstdint>
+
+#include "buffer.hpp"
+
+// a buffer that streams to a file descriptor, values are written into a
+// single fixed size block which is flushed whenever it fills up, so memory
+// use stays constant no matter how much is written. payloads larger than
+// the block bypass it and are written together with it in one writev
+class StreamWriter : public Buffer
+{
+public:
+  StreamWriter(int fd, size_t block_size);
+  StreamWriter(int fd);
+  ~StreamWriter();
+
+  int get_fd() const;
+  size_t get_block_size() const;
+  size_t get_flushed_size() const;
+
+  void flush();
+
+  using Buffer::write;
+  void write(const uint8_t *data, size_t size);
+  void pad(size_t size);
+
+protected:
+  void grow(size_t size);
+
+private:
+  void write_vectors(const uint8_t *data, size_t size);
+
+  int fd_ = -1;
+  size_t block_size_ = 0;
+  size_t flushed_size_ = 0;
+};
+
+// an iterator that streams from a file descriptor, the stream is read into
+// a fixed size window which is refilled whenever a read needs more bytes
+// than the window holds, so values and strings may straddle refills. the
+// window only grows for a single value larger than itself. views returned
+// by the read_*_view methods are invalidated by the next refill
+class StreamReader : public BufferIterator
+{
+public:
+  StreamReader(int fd, size_t window_size);
+  StreamReader(int fd);
+  ~StreamReader();
+
+  int get_fd() const;
+  size_t get_window_size() const;
+  size_t get_position() const;
+  bool is_eof();
+
+protected:
+  bool fill(size_t size);
+
+private:
+  int fd_ = -1;
+  uint8_t *window_data_ = nullptr;
+  size_t window_size_ = 0;
+  size_t window_capacity_ = 0;
+  size_t window_position_ = 0;
+  bool eof_ = false;
+  Buffer window_;
+};
+
+#endif // _STREAM_H
@@ -0,0 +1,236 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include "cpu.hpp"
+#include "byte_order.hpp"
+#include "varint.hpp"
+
+struct StreamVByteTables
+{
+  // for every control byte, the pshufb control that spreads the four
+  // packed values into four 32 bit lanes and their combined length
+  alignas(16) uint8_t shuffles[256][16];
+  uint8_t lengths[256];
+};
+
+typedef const uint8_t* (*StreamVByteDecodeFunction)(uint32_t *values, const uint8_t *control, const uint8_t *data, const uint8_t *data_end, size_t count);
+
+static StreamVByteTables build_stream_vbyte_tables()
+{
+  StreamVByteTables tables;
+  for (size_t control = 0; control < 256; control++)
+  {
+    uint8_t offset = 0;
+    for (size_t i = 0; i < 4; i++)
+    {
+      size_t length = ((control >> (2 * i)) & 3) + 1;
+      for (size_t j = 0; j < 4; j++)
+      {
+        tables.shuffles[control][i * 4 + j] = j < length ? (uint8_t)(offset + j) : 0xff;
+      }
+
+      offset += length;
+    }
+
+    tables.lengths[control] = offset;
+  }
+
+  return tables;
+}
+
+static const StreamVByteTables& get_stream_vbyte_tables()
+{
+  static const StreamVByteTables tables = build_stream_vbyte_tables();
+  return tables;
+}
+
+static inline size_t get_stream_vbyte_code(uint32_t value)
+{
+  return (value > 0xffffff) ? 3 : (value > 0xffff) ? 2 : (value > 0xff) ? 1 : 0;
+}
+
+// decodes the values from index onwards one at a time
+static const uint8_t* stream_vbyte_decode_scalar(uint32_t *values, const uint8_t *control, const uint8_t *data, size_t index, size_t count)
+{
+  for (size_t i = index; i < count; i++)
+  {
+    size_t length = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+    uint32_t value = 0;
+    for (size_t j = 0; j < length; j++)
+    {
+      value |= (uint32_t)data[j] << (8 * j);
+    }
+
+    values[i] = value;
+    data += length;
+  }
+
+  return data;
+}
+
+static const uint8_t* stream_vbyte_decode_generic(uint32_t *values, const uint8_t *control, const uint8_t *data, const uint8_t *data_end, size_t count)
+{
+  return stream_vbyte_decode_scalar(values, control, data, 0, count);
+}
+
+#ifdef SERIALBUF_X86
+
+__attribute__((target("ssse3")))
+static const uint8_t* stream_vbyte_decode_ssse3(uint32_t *values, const uint8_t *control, const uint8_t *data, const uint8_t *data_end, size_t count)
+{
+  const StreamVByteTables &tables = get_stream_vbyte_tables();
+  size_t group_count = count / 4;
+  size_t group = 0;
+
+  // every 16 byte load must stay inside the data, the last
+  // few groups are left to the scalar decoder
+  for (; group < group_count && data + 16 <= data_end; group++)
+  {
+    uint8_t group_control = control[group];
+    __m128i packed = _mm_loadu_si128((const __m128i*)data);
+    __m128i shuffle = _mm_load_si128((const __m128i*)tables.shuffles[group_control]);
+    _mm_storeu_si128((__m128i*)(values + group * 4), _mm_shuffle_epi8(packed, shuffle));
+    data += tables.lengths[group_control];
+  }
+
+  return stream_vbyte_decode_scalar(values, control, data, group * 4, count);
+}
+
+__attribute__((target("avx2")))
+static const uint8_t* stream_vbyte_decode_avx2(uint32_t *values, const uint8_t *control, const uint8_t *data, const uint8_t *data_end, size_t count)
+{
+  const StreamVByteTables &tables = get_stream_vbyte_tables();
+  size_t group_count = count / 4;
+  size_t group = 0;
+
+  // two groups per iteration, one in each 128 bit lane
+  for (; group + 2 <= group_count; group += 2)
+  {
+    uint8_t low_control = control[group];
+    uint8_t high_control = control[group + 1];
+    const uint8_t *high_data = data + tables.lengths[low_control];
+    if (high_data + 16 > data_end)
+    {
+      break;
+    }
+
+    __m256i packed = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)data)),
+      _mm_loadu_si128((const __m128i*)high_data), 1);
+
+    __m256i shuffle = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_load_si128((const __m128i*)tables.shuffles[low_control])),
+      _mm_load_si128((const __m128i*)tables.shuffles[high_control]), 1);
+
+    _mm256_storeu_si256((__m256i*)(values + group * 4), _mm256_shuffle_epi8(packed, shuffle));
+    data = high_data + tables.lengths[high_control];
+  }
+
+  return stream_vbyte_decode_scalar(values, control, data, group * 4, count);
+}
+
+#endif // SERIALBUF_X86
+
+static StreamVByteDecodeFunction resolve_stream_vbyte_decode()
+{
+#ifdef SERIALBUF_X86
+  if (cpu_has_avx2())
+  {
+    return stream_vbyte_decode_avx2;
+  }
+  else if (cpu_has_ssse3())
+  {
+    return stream_vbyte_decode_ssse3;
+  }
+#endif
+
+  return stream_vbyte_decode_generic;
+}
+
+size_t get_stream_vbyte_size(const uint32_t *values, size_t count)
+{
+  size_t size = get_stream_vbyte_control_size(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    size += get_stream_vbyte_code(values[i]) + 1;
+  }
+
+  return size;
+}
+
+size_t get_stream_vbyte_data_size(const uint8_t *control, size_t count)
+{
+  const StreamVByteTables &tables = get_stream_vbyte_tables();
+  size_t group_count = count / 4;
+  size_t size = 0;
+
+  for (size_t group = 0; group < group_count; group++)
+  {
+    size += tables.lengths[control[group]];
+  }
+
+  // the unused codes of a trailing partial group are not counted
+  for (size_t i = group_count * 4; i < count; i++)
+  {
+    size += ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+  }
+
+  return size;
+}
+
+size_t stream_vbyte_encode(uint8_t *data, const uint32_t *values, size_t count)
+{
+  size_t control_size = get_stream_vbyte_control_size(count);
+  uint8_t *control = data;
+  uint8_t *value_data = data + control_size;
+  memset(control, 0, control_size);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    uint32_t value = values[i];
+    size_t code = get_stream_vbyte_code(value);
+    control[i / 4] |= (uint8_t)(code << (2 * (i % 4)));
+
+    uint8_t bytes[4];
+    store_ordered<BUFFER_BYTE_ORDER_LITTLE>(bytes, value);
+    memcpy(value_data, bytes, code + 1);
+    value_data += code + 1;
+  }
+
+  return value_data - data;
+}
+
+size_t stream_vbyte_decode(uint32_t *values, const uint8_t *data, size_t count)
+{
+  static const StreamVByteDecodeFunction function = resolve_stream_vbyte_decode();
+
+  size_t control_size = get_stream_vbyte_control_size(count);
+  const uint8_t *control = data;
+  const uint8_t *value_data = data + control_size;
+  const uint8_t *value_data_end = value_data + get_stream_vbyte_data_size(control, count);
+
+  function(values, control, value_data, value_data_end, count);
+  return value_data_end - data;
+}
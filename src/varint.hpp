@@ -0,0 +1,122 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#ifndef _VARINT_H
+#define _VARINT_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+// the longest LEB128 encodings of a 32 and a 64 bit value
+static const size_t VARINT_MAX_SIZE32 = 5;
+static const size_t VARINT_MAX_SIZE64 = 10;
+
+// zigzag maps signed integers to unsigned ones so that values close to
+// zero, negative or positive, get the shortest varint encodings
+inline uint32_t zigzag_encode32(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t zigzag_decode32(uint32_t value)
+{
+  return (int32_t)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+inline uint64_t zigzag_encode64(int64_t value)
+{
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline int64_t zigzag_decode64(uint64_t value)
+{
+  return (int64_t)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+inline size_t get_varuint_size(uint64_t value)
+{
+  // 7 bits per byte, a value of zero still takes a byte
+  size_t bits = 64 - __builtin_clzll(value | 1);
+  return (bits + 6) / 7;
+}
+
+// encodes a LEB128 varint, the destination must have room
+// for get_varuint_size(value) bytes, returns the bytes written
+inline size_t encode_varuint(uint8_t *data, uint64_t value)
+{
+  size_t size = 0;
+  while (value >= 0x80)
+  {
+    data[size++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+
+  data[size++] = (uint8_t)value;
+  return size;
+}
+
+// decodes a LEB128 varint of at most max_size bytes, returns the bytes read
+// or zero when the data ends before the varint does or it is too long
+inline size_t decode_varuint(const uint8_t *data, size_t size, size_t max_size, uint64_t &value)
+{
+  if (size > max_size)
+  {
+    size = max_size;
+  }
+
+  uint64_t result = 0;
+  for (size_t i = 0; i < size; i++)
+  {
+    uint8_t byte = data[i];
+    result |= (uint64_t)(byte & 0x7f) << (7 * i);
+    if (byte < 0x80)
+    {
+      value = result;
+      return i + 1;
+    }
+  }
+
+  return 0;
+}
+
+// Stream VByte encodes an array of 32 bit values as a run of control bytes,
+// two bits per value giving its length of one to four bytes, followed by
+// the value bytes themselves in little endian order. keeping the lengths
+// apart from the data lets the decoder expand four values at once with a
+// single byte shuffle
+
+inline size_t get_stream_vbyte_control_size(size_t count)
+{
+  return (count + 3) / 4;
+}
+
+size_t get_stream_vbyte_size(const uint32_t *values, size_t count);
+size_t get_stream_vbyte_data_size(const uint8_t *control, size_t count);
+
+size_t stream_vbyte_encode(uint8_t *data, const uint32_t *values, size_t count);
+size_t stream_vbyte_decode(uint32_t *values, const uint8_t *data, size_t count);
+
+#endif // _VARINT_H
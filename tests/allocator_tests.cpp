@@ -0,0 +1,164 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "allocator.hpp"
+#include "buffer.hpp"
+
+TEST(AllocatorTests, arena_allocate)
+{
+  ArenaAllocator *allocator = new ArenaAllocator(256);
+
+  uint8_t *data = allocator->allocate(10);
+  uint8_t *data1 = allocator->allocate(10);
+  EXPECT_TRUE(data != nullptr);
+  EXPECT_TRUE(data1 != nullptr);
+  EXPECT_TRUE((uintptr_t)data1 % 16 == 0);
+  EXPECT_TRUE(data1 - data == 16);
+  ASSERT_EQ(allocator->get_used_size(), 32);
+
+  // an allocation larger than the block size gets a block of its own
+  uint8_t *data2 = allocator->allocate(1024);
+  EXPECT_TRUE(data2 != nullptr);
+  ASSERT_EQ(allocator->get_block_count(), 2);
+
+  allocator->reset();
+  ASSERT_EQ(allocator->get_used_size(), 0);
+  EXPECT_TRUE(allocator->allocate(10) == data);
+
+  delete allocator;
+}
+
+TEST(AllocatorTests, arena_reallocate_in_place)
+{
+  ArenaAllocator *allocator = new ArenaAllocator(1024);
+
+  uint8_t *data = allocator->allocate(16);
+  memset(data, 0xab, 16);
+  EXPECT_TRUE(allocator->reallocate(data, 16, 512) == data);
+
+  // once another allocation follows, growing must move the data
+  allocator->allocate(16);
+  uint8_t *data1 = allocator->reallocate(data, 512, 600);
+  EXPECT_TRUE(data1 != data);
+  for (size_t i = 0; i < 16; i++)
+  {
+    ASSERT_EQ(data1[i], 0xab);
+  }
+
+  delete allocator;
+}
+
+TEST(AllocatorTests, pool_size_classes)
+{
+  ASSERT_EQ(PoolAllocator::get_size_class(0), 0);
+  ASSERT_EQ(PoolAllocator::get_size_class(16), 0);
+  ASSERT_EQ(PoolAllocator::get_size_class(17), 1);
+  ASSERT_EQ(PoolAllocator::get_size_class(32), 1);
+  ASSERT_EQ(PoolAllocator::get_size_class(65536), 12);
+}
+
+TEST(AllocatorTests, pool_recycle)
+{
+  PoolAllocator *allocator = new PoolAllocator();
+
+  uint8_t *data = allocator->allocate(100);
+  uint8_t *data1 = allocator->allocate(100);
+  EXPECT_TRUE(data != data1);
+
+  allocator->deallocate(data, 100);
+  EXPECT_TRUE(allocator->allocate(120) == data);
+
+  // growing within the same size class keeps the allocation
+  EXPECT_TRUE(allocator->reallocate(data1, 100, 128) == data1);
+
+  uint8_t *large = allocator->allocate(1 << 20);
+  EXPECT_TRUE(large != nullptr);
+  allocator->deallocate(large, 1 << 20);
+
+  delete allocator;
+}
+
+TEST(AllocatorTests, buffer_with_arena)
+{
+  ArenaAllocator *allocator = new ArenaAllocator();
+
+  for (uint32_t n = 0; n < 4; n++)
+  {
+    Buffer *buffer = new Buffer(allocator);
+    EXPECT_TRUE(buffer->get_allocator() == allocator);
+
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+      buffer->write_uint32(i);
+    }
+
+    BufferIterator *buffer_iterator = new BufferIterator(buffer);
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+      ASSERT_EQ(buffer_iterator->read_uint32(), i);
+    }
+
+    delete buffer;
+    delete buffer_iterator;
+    allocator->reset();
+  }
+
+  delete allocator;
+}
+
+TEST(AllocatorTests, buffer_with_pool)
+{
+  PoolAllocator *allocator = new PoolAllocator();
+
+  Buffer *buffer = new Buffer(allocator);
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    buffer->write_string(str);
+  }
+
+  EXPECT_THROW(buffer->set_allocator(BufferAllocator::get_default()), std::runtime_error);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    EXPECT_TRUE(buffer_iterator->read_string().compare(str) == 0);
+  }
+
+  delete buffer;
+  delete buffer_iterator;
+  delete allocator;
+}
@@ -31,6 +31,7 @@
 #include <string>
 #include <sstream>
 #include <limits>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -213,3 +214,603 @@ TEST(BufferTests, write_string)
   delete buffer;
   delete buffer_iterator;
 }
+
+TEST(BufferTests, reserve)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->reserve(1024);
+  EXPECT_TRUE(buffer->get_capacity() == 1024);
+  EXPECT_TRUE(buffer->get_size() == 0);
+
+  const uint8_t *data = buffer->get_data();
+  for (uint32_t i = 0; i < 256; i++)
+  {
+    buffer->write_uint32(i);
+  }
+
+  EXPECT_TRUE(buffer->get_data() == data);
+  EXPECT_TRUE(buffer->get_capacity() == 1024);
+  EXPECT_TRUE(buffer->get_size() == 1024);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  for (uint32_t i = 0; i < 256; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint32(), i);
+  }
+
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, geometric_growth)
+{
+  Buffer *buffer = new Buffer();
+
+  size_t reallocations = 0;
+  size_t capacity = buffer->get_capacity();
+  for (uint32_t i = 0; i < 1000000; i++)
+  {
+    buffer->write_uint32(i);
+    if (buffer->get_capacity() != capacity)
+    {
+      capacity = buffer->get_capacity();
+      reallocations++;
+    }
+  }
+
+  EXPECT_TRUE(buffer->get_size() == 4000000);
+  EXPECT_TRUE(buffer->get_capacity() >= buffer->get_size());
+  EXPECT_TRUE(reallocations < 32);
+
+  delete buffer;
+}
+
+TEST(BufferTests, shrink_to_fit)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->reserve(4096);
+  buffer->write_uint64(std::numeric_limits<uint64_t>::max());
+  buffer->shrink_to_fit();
+  EXPECT_TRUE(buffer->get_capacity() == 8);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint64(), std::numeric_limits<uint64_t>::max());
+
+  buffer->clear();
+  buffer->shrink_to_fit();
+  EXPECT_TRUE(buffer->get_capacity() == 0);
+  EXPECT_TRUE(buffer->get_data() == nullptr);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, pad)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->write_uint8(std::numeric_limits<uint8_t>::max());
+  buffer->pad(15);
+  EXPECT_TRUE(buffer->get_size() == 16);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint8(), std::numeric_limits<uint8_t>::max());
+  for (size_t i = 0; i < 15; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint8(), 0);
+  }
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, read_string_view)
+{
+  Buffer *buffer = new Buffer();
+
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+  std::string str1(1024, 'x');
+  buffer->write_string(str);
+  buffer->write_string(str1);
+  buffer->write_string16(str);
+  buffer->write_padded_string(str, 64);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+
+  BufferView view = buffer_iterator->read_string_view();
+  EXPECT_TRUE(view.compare(str));
+  EXPECT_TRUE(view.get_data() >= buffer->get_data());
+  EXPECT_TRUE(view.get_data() + view.get_size() <= buffer->get_data() + buffer->get_size());
+
+  EXPECT_TRUE(buffer_iterator->read_string_view().compare(str1));
+  EXPECT_TRUE(buffer_iterator->read_string16_view().compare(str));
+
+  BufferView padded_view = buffer_iterator->read_padded_string_view(64);
+  ASSERT_EQ(padded_view.get_size(), 64);
+  EXPECT_TRUE(BufferView(padded_view.get_data(), str.size()).compare(str));
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, read_view)
+{
+  Buffer *buffer = new Buffer();
+
+  const uint8_t data[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  buffer->write(data, sizeof(data));
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  buffer_iterator->skip_read(2);
+
+  BufferView view = buffer_iterator->read_view(4);
+  ASSERT_EQ(view.get_size(), 4);
+  EXPECT_TRUE(view.get_data() == buffer->get_data() + 2);
+  EXPECT_TRUE(memcmp(view.get_data(), data + 2, 4) == 0);
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 2);
+  EXPECT_THROW(buffer_iterator->read_view(3), std::runtime_error);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, move)
+{
+  Buffer buffer;
+  buffer.write_uint32(std::numeric_limits<uint32_t>::max());
+  const uint8_t *data = buffer.get_data();
+
+  Buffer other_buffer(std::move(buffer));
+  EXPECT_TRUE(other_buffer.get_data() == data);
+  EXPECT_TRUE(other_buffer.get_size() == 4);
+  EXPECT_TRUE(other_buffer.get_offset() == 4);
+  EXPECT_TRUE(buffer.get_data() == nullptr);
+  EXPECT_TRUE(buffer.get_size() == 0);
+
+  Buffer moved_buffer;
+  moved_buffer.write_uint8(0);
+  moved_buffer = std::move(other_buffer);
+  EXPECT_TRUE(moved_buffer.get_data() == data);
+  EXPECT_TRUE(other_buffer.get_data() == nullptr);
+
+  BufferIterator buffer_iterator(&moved_buffer);
+  ASSERT_EQ(buffer_iterator.read_uint32(), std::numeric_limits<uint32_t>::max());
+}
+
+TEST(BufferTests, swap)
+{
+  Buffer buffer;
+  Buffer other_buffer;
+  buffer.write_uint8(1);
+  other_buffer.write_uint16(2);
+
+  buffer.swap(other_buffer);
+
+  BufferIterator buffer_iterator(&buffer);
+  ASSERT_EQ(buffer_iterator.read_uint16(), 2);
+  EXPECT_TRUE(buffer_iterator.get_remaining_size() == 0);
+
+  BufferIterator other_buffer_iterator(&other_buffer);
+  ASSERT_EQ(other_buffer_iterator.read_uint8(), 1);
+  EXPECT_TRUE(other_buffer_iterator.get_remaining_size() == 0);
+}
+
+TEST(BufferTests, release_and_adopt)
+{
+  Buffer buffer;
+  buffer.write_uint64(std::numeric_limits<uint64_t>::max());
+
+  size_t size = buffer.get_size();
+  size_t capacity = buffer.get_capacity();
+  BufferAllocator *allocator = buffer.get_allocator();
+  uint8_t *data = buffer.release();
+  EXPECT_TRUE(data != nullptr);
+  EXPECT_TRUE(buffer.get_data() == nullptr);
+  EXPECT_TRUE(buffer.get_capacity() == 0);
+
+  Buffer adopted_buffer(data, size, capacity, allocator);
+  EXPECT_TRUE(adopted_buffer.get_data() == data);
+  EXPECT_TRUE(adopted_buffer.get_offset() == 0);
+
+  BufferIterator buffer_iterator(&adopted_buffer);
+  ASSERT_EQ(buffer_iterator.read_uint64(), std::numeric_limits<uint64_t>::max());
+}
+
+TEST(BufferTests, copy)
+{
+  Buffer buffer;
+  buffer.write_string("A quick brown fox jumps over the lazy dog.");
+
+  Buffer other_buffer;
+  other_buffer.reserve(1024);
+  const uint8_t *data = other_buffer.get_data();
+
+  buffer.copy(&other_buffer);
+  EXPECT_TRUE(other_buffer.get_data() == data);
+  EXPECT_TRUE(other_buffer.get_data() != buffer.get_data());
+  EXPECT_TRUE(buffer.compare(&other_buffer));
+}
+
+TEST(BufferTests, borrowed_data)
+{
+  Buffer *source_buffer = new Buffer();
+  source_buffer->write_uint32(std::numeric_limits<uint32_t>::max());
+  source_buffer->write_string("A quick brown fox jumps over the lazy dog.");
+
+  Buffer *buffer = new Buffer();
+  buffer->set_borrowed_data(source_buffer->get_data(), source_buffer->get_size());
+  EXPECT_TRUE(buffer->is_borrowed());
+  EXPECT_TRUE(buffer->get_data() == source_buffer->get_data());
+  EXPECT_TRUE(buffer->get_capacity() == 0);
+  EXPECT_THROW(buffer->release(), std::runtime_error);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint32(), std::numeric_limits<uint32_t>::max());
+
+  BufferView view = buffer_iterator->read_string_view();
+  EXPECT_TRUE(view.compare(std::string("A quick brown fox jumps over the lazy dog.")));
+  EXPECT_TRUE(view.get_data() > source_buffer->get_data());
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  // writing moves the data into the buffer's own storage
+  buffer->set_offset(0);
+  buffer->write_uint32(0);
+  EXPECT_FALSE(buffer->is_borrowed());
+  EXPECT_TRUE(buffer->get_data() != source_buffer->get_data());
+  EXPECT_TRUE(buffer->get_size() == source_buffer->get_size());
+
+  BufferIterator *source_buffer_iterator = new BufferIterator(source_buffer);
+  ASSERT_EQ(source_buffer_iterator->read_uint32(), std::numeric_limits<uint32_t>::max());
+
+  buffer_iterator->set_offset(0);
+  ASSERT_EQ(buffer_iterator->read_uint32(), 0);
+  EXPECT_TRUE(buffer_iterator->read_string().compare("A quick brown fox jumps over the lazy dog.") == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+  delete source_buffer;
+  delete source_buffer_iterator;
+}
+
+template <typename Type>
+static void test_array()
+{
+  Buffer *buffer = new Buffer();
+
+  std::vector<Type> values;
+  values.push_back(std::numeric_limits<Type>::lowest());
+  values.push_back(std::numeric_limits<Type>::max());
+  for (size_t i = 0; i < 100; i++)
+  {
+    values.push_back((Type)(i * 3));
+  }
+
+  buffer->write_array(values.data(), values.size());
+  ASSERT_EQ(buffer->get_size(), values.size() * sizeof(Type));
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  std::vector<Type> read_values(values.size());
+  buffer_iterator->read_array(read_values.data(), read_values.size());
+  EXPECT_TRUE(read_values == values);
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+  EXPECT_THROW(buffer_iterator->read_array(read_values.data(), 1), std::runtime_error);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, write_array)
+{
+  test_array<uint8_t>();
+  test_array<int8_t>();
+  test_array<uint16_t>();
+  test_array<int16_t>();
+  test_array<uint32_t>();
+  test_array<int32_t>();
+  test_array<uint64_t>();
+  test_array<int64_t>();
+  test_array<float>();
+  test_array<double>();
+}
+
+TEST(BufferTests, write_array_matches_values)
+{
+  Buffer *buffer = new Buffer();
+  Buffer *other_buffer = new Buffer();
+
+  std::vector<float> values;
+  for (size_t i = 0; i < 1000; i++)
+  {
+    values.push_back(i * 0.25f);
+  }
+
+  buffer->write_array(values.data(), values.size());
+  for (float value : values)
+  {
+    other_buffer->write_float32(value);
+  }
+
+  EXPECT_TRUE(buffer->compare(other_buffer));
+
+  delete buffer;
+  delete other_buffer;
+}
+
+TEST(BufferTests, write_fields)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->write_fields((uint32_t)0xdeadbeef, (uint16_t)7, -1.5, (int8_t)-3);
+  ASSERT_EQ(buffer->get_size(), 4 + 2 + 8 + 1);
+
+  Buffer *other_buffer = new Buffer();
+  other_buffer->write_uint32(0xdeadbeef);
+  other_buffer->write_uint16(7);
+  other_buffer->write_float64(-1.5);
+  other_buffer->write_int8(-3);
+  EXPECT_TRUE(buffer->compare(other_buffer));
+
+  delete buffer;
+  delete other_buffer;
+}
+
+TEST(BufferTests, read_fields)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->write_fields((uint32_t)0xdeadbeef, (uint16_t)7, -1.5, (int8_t)-3);
+  buffer->write_fields((uint32_t)1, (uint16_t)2, 3.0, (int8_t)4);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+
+  std::tuple<uint32_t, uint16_t, double, int8_t> fields = buffer_iterator->read_fields<uint32_t, uint16_t, double, int8_t>();
+  ASSERT_EQ(std::get<0>(fields), 0xdeadbeef);
+  ASSERT_EQ(std::get<1>(fields), 7);
+  ASSERT_EQ(std::get<2>(fields), -1.5);
+  ASSERT_EQ(std::get<3>(fields), -3);
+
+  struct
+  {
+    uint32_t magic;
+    uint16_t version;
+    double timestamp;
+    int8_t flags;
+  } header;
+
+  buffer_iterator->read_fields(header.magic, header.version, header.timestamp, header.flags);
+  ASSERT_EQ(header.magic, 1u);
+  ASSERT_EQ(header.version, 2);
+  ASSERT_EQ(header.timestamp, 3.0);
+  ASSERT_EQ(header.flags, 4);
+
+  // a short read fails without consuming anything
+  buffer_iterator->set_offset(buffer->get_size() - 4);
+  EXPECT_THROW((buffer_iterator->read_fields<uint32_t, uint8_t>()), std::runtime_error);
+  ASSERT_EQ(buffer_iterator->get_offset(), buffer->get_size() - 4);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, generic_write_and_read)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->write<uint8_t>(0xab);
+  buffer->write<int16_t>(-2);
+  buffer->write<uint32_t>(0xdeadbeef);
+  buffer->write<int64_t>(std::numeric_limits<int64_t>::min());
+  buffer->write<float>(1.25f);
+  buffer->write<double>(-0.5);
+
+  Buffer *other_buffer = new Buffer();
+  other_buffer->write_uint8(0xab);
+  other_buffer->write_int16(-2);
+  other_buffer->write_uint32(0xdeadbeef);
+  other_buffer->write_int64(std::numeric_limits<int64_t>::min());
+  other_buffer->write_float32(1.25f);
+  other_buffer->write_float64(-0.5);
+  EXPECT_TRUE(buffer->compare(other_buffer));
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read<uint8_t>(), 0xab);
+  ASSERT_EQ(buffer_iterator->read<int16_t>(), -2);
+  ASSERT_EQ(buffer_iterator->read<uint32_t>(), 0xdeadbeef);
+  ASSERT_EQ(buffer_iterator->read<int64_t>(), std::numeric_limits<int64_t>::min());
+  ASSERT_EQ(buffer_iterator->read<float>(), 1.25f);
+  ASSERT_EQ(buffer_iterator->read<double>(), -0.5);
+  EXPECT_THROW(buffer_iterator->read<uint8_t>(), std::runtime_error);
+
+  delete buffer;
+  delete other_buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, try_read_partial)
+{
+  Buffer *buffer = new Buffer();
+  buffer->write_uint32(0xdeadbeef);
+  buffer->write_string16("hello");
+  buffer->write_varuint64(300);
+  buffer->write_string("world");
+  buffer->write_float64(2.5);
+
+  // every truncation of the frame decodes as far as it can, a failed
+  // read leaves the offset where it was
+  for (size_t size = 0; size <= buffer->get_size(); size++)
+  {
+    Buffer *partial_buffer = new Buffer();
+    partial_buffer->set_borrowed_data(buffer->get_data(), size);
+    BufferIterator *buffer_iterator = new BufferIterator(partial_buffer);
+
+    uint32_t value = 0;
+    std::string str;
+    uint64_t varint = 0;
+    BufferView view;
+    double value1 = 0;
+
+    size_t offset = 0;
+    bool complete = (
+      (offset = buffer_iterator->get_offset(), buffer_iterator->try_read_uint32(value)) &&
+      (offset = buffer_iterator->get_offset(), buffer_iterator->try_read_string16(str)) &&
+      (offset = buffer_iterator->get_offset(), buffer_iterator->try_read_varuint64(varint)) &&
+      (offset = buffer_iterator->get_offset(), buffer_iterator->try_read_string_view(view)) &&
+      (offset = buffer_iterator->get_offset(), buffer_iterator->try_read_float64(value1)));
+
+    if (complete)
+    {
+      ASSERT_EQ(size, buffer->get_size());
+      ASSERT_EQ(value, 0xdeadbeef);
+      ASSERT_EQ(str, "hello");
+      ASSERT_EQ(varint, 300u);
+      EXPECT_TRUE(view.compare("world"));
+      ASSERT_EQ(value1, 2.5);
+    }
+    else
+    {
+      ASSERT_LT(size, buffer->get_size());
+      ASSERT_EQ(buffer_iterator->get_offset(), offset);
+    }
+
+    delete partial_buffer;
+    delete buffer_iterator;
+  }
+
+  delete buffer;
+}
+
+TEST(BufferTests, try_read_malformed)
+{
+  Buffer *buffer = new Buffer();
+  buffer->write_uint8(0xff);
+  buffer->write_uint8(0xff);
+  buffer->write_uint8(0xff);
+  buffer->write_uint8(0xff);
+  buffer->write_uint8(0xff);
+  buffer->write_uint8(0x01);
+
+  // malformed data is not a short read and still throws
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  uint32_t value = 0;
+  EXPECT_THROW(buffer_iterator->try_read_varuint32(value), std::runtime_error);
+
+  std::string str;
+  EXPECT_THROW(buffer_iterator->try_read_string(str), std::runtime_error);
+  ASSERT_EQ(buffer_iterator->get_offset(), 0);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, prepare_and_commit)
+{
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+  Buffer *buffer = new Buffer();
+  buffer->write_uint32(7);
+
+  // produce bytes straight into the buffer, only the bytes
+  // that were actually produced are committed
+  uint8_t *data = buffer->prepare(4096);
+  ASSERT_TRUE(buffer->get_capacity() - buffer->get_offset() >= 4096);
+  ASSERT_EQ(buffer->get_size(), 4);
+
+  memcpy(data, str.c_str(), str.size());
+  buffer->commit(str.size());
+  ASSERT_EQ(buffer->get_size(), 4 + str.size());
+  ASSERT_EQ(buffer->get_offset(), 4 + str.size());
+
+  buffer->write_uint8(1);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint32(), 7);
+  EXPECT_TRUE(buffer_iterator->read_view(str.size()).compare(str));
+  ASSERT_EQ(buffer_iterator->read_uint8(), 1);
+
+  EXPECT_THROW(buffer->commit(buffer->get_capacity()), std::runtime_error);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(BufferTests, commit_borrowed)
+{
+  uint8_t data[16] = {};
+  Buffer *buffer = new Buffer(data, sizeof(data));
+  buffer->set_offset(8);
+
+  // borrowed data has nothing prepared, even with the offset past its capacity
+  EXPECT_THROW(buffer->commit(100), std::runtime_error);
+  ASSERT_EQ(buffer->get_size(), sizeof(data));
+
+  // preparing moves the bytes into storage of the buffer's own
+  buffer->prepare(4);
+  buffer->commit(4);
+  ASSERT_EQ(buffer->get_size(), sizeof(data));
+  EXPECT_FALSE(buffer->is_borrowed());
+
+  delete buffer;
+}
+
+TEST(BufferTests, reserve_slot_and_patch)
+{
+  // a message with a nested length prefixed message written in one pass
+  Buffer *buffer = new Buffer();
+  buffer->write_uint8(1);
+  BufferSlot<uint32_t> slot = buffer->reserve_slot<uint32_t>();
+  size_t begin = buffer->get_offset();
+  buffer->write_string("A quick brown fox jumps over the lazy dog.");
+  buffer->write_uint64(7);
+  buffer->patch(slot, (uint32_t)(buffer->get_offset() - begin));
+  buffer->write_uint8(2);
+
+  // the same message written with a temporary buffer
+  Buffer *nested_buffer = new Buffer();
+  nested_buffer->write_string("A quick brown fox jumps over the lazy dog.");
+  nested_buffer->write_uint64(7);
+
+  Buffer *other_buffer = new Buffer();
+  other_buffer->write_uint8(1);
+  other_buffer->write_uint32(nested_buffer->get_size());
+  other_buffer->write(nested_buffer->get_data(), nested_buffer->get_size());
+  other_buffer->write_uint8(2);
+  EXPECT_TRUE(buffer->compare(other_buffer));
+
+  BufferSlot<uint64_t> other_slot = { buffer->get_size() - 4 };
+  EXPECT_THROW(buffer->patch(other_slot, (uint64_t)0), std::runtime_error);
+
+  delete buffer;
+  delete nested_buffer;
+  delete other_buffer;
+}
+
+TEST(BufferTests, mark_and_rewind)
+{
+  Buffer *buffer = new Buffer();
+  buffer->write_uint32(1);
+
+  // a message that turns out to be invalid halfway is dropped again
+  BufferMark mark = buffer->mark();
+  buffer->write_string("A quick brown fox jumps over the lazy dog.");
+  buffer->write_uint64(7);
+  buffer->rewind(mark);
+  ASSERT_EQ(buffer->get_size(), 4);
+  ASSERT_EQ(buffer->get_offset(), 4);
+
+  buffer->write_uint32(2);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint32(), 1);
+  ASSERT_EQ(buffer_iterator->read_uint32(), 2);
+  ASSERT_EQ(buffer_iterator->get_remaining_size(), 0);
+
+  BufferMark other_mark = { 0, 100 };
+  EXPECT_THROW(buffer->rewind(other_mark), std::runtime_error);
+
+  delete buffer;
+  delete buffer_iterator;
+}
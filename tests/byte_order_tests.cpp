@@ -0,0 +1,169 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "byte_order.hpp"
+#include "buffer.hpp"
+
+TEST(ByteOrderTests, byte_swap)
+{
+  ASSERT_EQ(byte_swap((uint16_t)0x0102), 0x0201);
+  ASSERT_EQ(byte_swap((uint32_t)0x01020304), 0x04030201u);
+  ASSERT_EQ(byte_swap((uint64_t)0x0102030405060708ull), 0x0807060504030201ull);
+}
+
+TEST(ByteOrderTests, store_ordered)
+{
+  uint8_t data[8];
+
+  store_ordered<BUFFER_BYTE_ORDER_BIG>(data, (uint32_t)0x01020304);
+  EXPECT_TRUE(data[0] == 1 && data[1] == 2 && data[2] == 3 && data[3] == 4);
+  ASSERT_EQ((load_ordered<BUFFER_BYTE_ORDER_BIG, uint32_t>(data)), 0x01020304u);
+
+  store_ordered<BUFFER_BYTE_ORDER_LITTLE>(data, (uint32_t)0x01020304);
+  EXPECT_TRUE(data[0] == 4 && data[1] == 3 && data[2] == 2 && data[3] == 1);
+  ASSERT_EQ((load_ordered<BUFFER_BYTE_ORDER_LITTLE, uint32_t>(data)), 0x01020304u);
+
+  store_ordered<BUFFER_BYTE_ORDER_NETWORK>(data, -1.5);
+  ASSERT_EQ((load_ordered<BUFFER_BYTE_ORDER_NETWORK, double>(data)), -1.5);
+}
+
+TEST(ByteOrderTests, byte_swap_array)
+{
+  // enough values to cover the vector loops and their scalar tails
+  for (size_t count = 0; count < 100; count++)
+  {
+    std::vector<uint16_t> values16(count);
+    std::vector<uint32_t> values32(count);
+    std::vector<uint64_t> values64(count);
+    for (size_t i = 0; i < count; i++)
+    {
+      values16[i] = (uint16_t)(i * 0x0101 + 0x0102);
+      values32[i] = (uint32_t)(i * 0x01010101 + 0x01020304);
+      values64[i] = (uint64_t)(i * 0x0101010101010101ull + 0x0102030405060708ull);
+    }
+
+    std::vector<uint16_t> swapped16(count);
+    std::vector<uint32_t> swapped32(count);
+    std::vector<uint64_t> swapped64(count);
+    byte_swap_array((uint8_t*)swapped16.data(), (const uint8_t*)values16.data(), count, 2);
+    byte_swap_array((uint8_t*)swapped32.data(), (const uint8_t*)values32.data(), count, 4);
+    byte_swap_array((uint8_t*)swapped64.data(), (const uint8_t*)values64.data(), count, 8);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      ASSERT_EQ(swapped16[i], byte_swap(values16[i]));
+      ASSERT_EQ(swapped32[i], byte_swap(values32[i]));
+      ASSERT_EQ(swapped64[i], byte_swap(values64[i]));
+    }
+
+    // swapping in place
+    byte_swap_array((uint8_t*)swapped32.data(), (const uint8_t*)swapped32.data(), count, 4);
+    EXPECT_TRUE(swapped32 == values32);
+  }
+}
+
+TEST(ByteOrderTests, buffer_wire_order)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->write_uint32(0x01020304);
+  buffer->write_ordered<BUFFER_BYTE_ORDER_BIG>((uint32_t)0x01020304);
+
+  const uint8_t expected[] = { 4, 3, 2, 1, 1, 2, 3, 4 };
+  ASSERT_EQ(buffer->get_size(), sizeof(expected));
+  EXPECT_TRUE(memcmp(buffer->get_data(), expected, sizeof(expected)) == 0);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ((buffer_iterator->read_ordered<BUFFER_BYTE_ORDER_BIG, uint32_t>()), 0x04030201u);
+  ASSERT_EQ((buffer_iterator->read_ordered<BUFFER_BYTE_ORDER_BIG, uint32_t>()), 0x01020304u);
+  EXPECT_THROW((buffer_iterator->read_ordered<BUFFER_BYTE_ORDER_BIG, uint16_t>()), std::runtime_error);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(ByteOrderTests, buffer_ordered_values)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->write_ordered<BUFFER_BYTE_ORDER_NETWORK>(std::numeric_limits<int16_t>::min());
+  buffer->write_ordered<BUFFER_BYTE_ORDER_NETWORK>(std::numeric_limits<int64_t>::max());
+  buffer->write_ordered<BUFFER_BYTE_ORDER_NETWORK>(-std::numeric_limits<float>::max());
+  buffer->write_ordered<BUFFER_BYTE_ORDER_NETWORK>(std::numeric_limits<double>::max());
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ((buffer_iterator->read_ordered<BUFFER_BYTE_ORDER_NETWORK, int16_t>()), std::numeric_limits<int16_t>::min());
+  ASSERT_EQ((buffer_iterator->read_ordered<BUFFER_BYTE_ORDER_NETWORK, int64_t>()), std::numeric_limits<int64_t>::max());
+  ASSERT_EQ((buffer_iterator->read_ordered<BUFFER_BYTE_ORDER_NETWORK, float>()), -std::numeric_limits<float>::max());
+  ASSERT_EQ((buffer_iterator->read_ordered<BUFFER_BYTE_ORDER_NETWORK, double>()), std::numeric_limits<double>::max());
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(ByteOrderTests, buffer_ordered_array)
+{
+  Buffer *buffer = new Buffer();
+
+  std::vector<uint32_t> values;
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    values.push_back(i * 7919);
+  }
+
+  buffer->write_ordered_array<BUFFER_BYTE_ORDER_BIG>(values.data(), values.size());
+  buffer->write_ordered_array<BUFFER_BYTE_ORDER_LITTLE>(values.data(), values.size());
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  for (uint32_t i = 0; i < 10; i++)
+  {
+    ASSERT_EQ((buffer_iterator->read_ordered<BUFFER_BYTE_ORDER_BIG, uint32_t>()), values[i]);
+  }
+
+  std::vector<uint32_t> read_values(values.size() - 10);
+  buffer_iterator->read_ordered_array<BUFFER_BYTE_ORDER_BIG>(read_values.data(), read_values.size());
+  EXPECT_TRUE(std::equal(read_values.begin(), read_values.end(), values.begin() + 10));
+
+  read_values.resize(values.size());
+  buffer_iterator->read_ordered_array<BUFFER_BYTE_ORDER_LITTLE>(read_values.data(), read_values.size());
+  EXPECT_TRUE(read_values == values);
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+}
@@ -0,0 +1,281 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <type_traits>
+
+#include <gtest/gtest.h>
+
+#include "chained_buffer.hpp"
+
+// the chain is not a Buffer, it only shares the write methods
+template <typename BufferType>
+static void write_values(BufferType *buffer)
+{
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    buffer->write_uint8(i & 0xff);
+    buffer->write_uint32(i);
+    buffer->write_varuint64(i * 1000);
+    buffer->write_float64(i * 0.5);
+    buffer->write_string(str);
+  }
+
+  std::string str1(1000, 'x');
+  buffer->write_string(str1);
+}
+
+static void read_values(BufferIterator *buffer_iterator)
+{
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint8(), i & 0xff);
+    ASSERT_EQ(buffer_iterator->read_uint32(), i);
+    ASSERT_EQ(buffer_iterator->read_varuint64(), i * 1000);
+    ASSERT_EQ(buffer_iterator->read_float64(), i * 0.5);
+    ASSERT_EQ(buffer_iterator->read_string(), str);
+  }
+
+  std::string str1(1000, 'x');
+  ASSERT_EQ(buffer_iterator->read_string(), str1);
+}
+
+TEST(ChainedBufferTests, write_and_read)
+{
+  // a segment size that is not a multiple of any value size makes
+  // plenty of strings and values straddle segments
+  ChainedBuffer *buffer = new ChainedBuffer(37);
+  write_values(buffer);
+  EXPECT_TRUE(buffer->get_segment_count() > 1);
+
+  Buffer *other_buffer = new Buffer();
+  write_values(other_buffer);
+  ASSERT_EQ(buffer->get_total_size(), other_buffer->get_size());
+
+  ChainedBufferIterator *buffer_iterator = new ChainedBufferIterator(buffer);
+  read_values(buffer_iterator);
+  ASSERT_EQ(buffer_iterator->get_position(), buffer->get_total_size());
+  EXPECT_THROW(buffer_iterator->read_uint8(), std::runtime_error);
+
+  delete buffer_iterator;
+  delete buffer;
+  delete other_buffer;
+}
+
+TEST(ChainedBufferTests, never_relocates)
+{
+  ChainedBuffer *buffer = new ChainedBuffer(64);
+  buffer->write_uint64(1);
+  const uint8_t *data = buffer->get_segment(0).get_data();
+
+  for (uint32_t i = 0; i < 10000; i++)
+  {
+    buffer->write_uint32(i);
+  }
+
+  EXPECT_TRUE(buffer->get_segment(0).get_data() == data);
+  ASSERT_EQ(buffer->get_total_size(), 8 + 10000 * 4);
+
+  // a value never straddles segments on write, a segment
+  // only ends early when the next value does not fit
+  for (size_t i = 0; i < buffer->get_segment_count(); i++)
+  {
+    EXPECT_TRUE(buffer->get_segment(i).get_size() <= 64);
+  }
+
+  delete buffer;
+}
+
+TEST(ChainedBufferTests, prepend)
+{
+  ChainedBuffer *buffer = new ChainedBuffer(16);
+  for (uint32_t i = 0; i < 100; i++)
+  {
+    buffer->write_uint32(i);
+  }
+
+  // a length header is added in front of the finished body
+  Buffer header;
+  header.write_uint32(buffer->get_total_size());
+  buffer->prepend(header.get_data(), header.get_size());
+  ASSERT_EQ(buffer->get_total_size(), 404);
+
+  ChainedBufferIterator *buffer_iterator = new ChainedBufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint32(), 400);
+  for (uint32_t i = 0; i < 100; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint32(), i);
+  }
+
+  delete buffer_iterator;
+  delete buffer;
+}
+
+TEST(ChainedBufferTests, iovecs)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  ChainedBuffer *buffer = new ChainedBuffer(100);
+  write_values(buffer);
+
+  std::vector<struct iovec> iovecs;
+  buffer->get_iovecs(iovecs);
+  ASSERT_EQ(iovecs.size(), buffer->get_segment_count());
+
+  size_t size = 0;
+  for (const struct iovec &iov : iovecs)
+  {
+    size += iov.iov_len;
+  }
+
+  ASSERT_EQ(size, buffer->get_total_size());
+  ASSERT_EQ(writev(fileno(file), iovecs.data(), iovecs.size()), (ssize_t)size);
+
+  // the scattered segments read back as one contiguous message
+  Buffer *other_buffer = new Buffer();
+  other_buffer->pad(size);
+  lseek(fileno(file), 0, SEEK_SET);
+  ASSERT_EQ(read(fileno(file), (uint8_t*)other_buffer->get_data(), size), (ssize_t)size);
+
+  BufferIterator *buffer_iterator = new BufferIterator(other_buffer);
+  read_values(buffer_iterator);
+
+  delete buffer_iterator;
+  delete buffer;
+  delete other_buffer;
+  fclose(file);
+}
+
+TEST(ChainedBufferTests, try_read_across_segments)
+{
+  ChainedBuffer *buffer = new ChainedBuffer(6);
+  buffer->write_uint32(1);
+  buffer->write_uint16(2);
+  buffer->write_uint8(3);
+
+  ChainedBufferIterator *buffer_iterator = new ChainedBufferIterator(buffer);
+  uint16_t value = 0;
+  ASSERT_TRUE(buffer_iterator->try_read_uint16(value));
+
+  // fewer than eight bytes are left across both segments
+  uint64_t value1 = 0;
+  EXPECT_FALSE(buffer_iterator->try_read_uint64(value1));
+  ASSERT_EQ(buffer_iterator->get_position(), 2);
+
+  uint32_t value2 = 0;
+  ASSERT_TRUE(buffer_iterator->try_read_uint32(value2));
+  ASSERT_EQ(value2, (2u << 16));
+  ASSERT_EQ(buffer_iterator->read_uint8(), 3);
+
+  delete buffer_iterator;
+  delete buffer;
+}
+
+TEST(ChainedBufferTests, not_a_buffer)
+{
+  // a Buffer pointer to a chain would only see its last segment, so
+  // iterators, copies and comparisons cannot be handed a chain
+  static_assert(!std::is_convertible<ChainedBuffer*, Buffer*>::value, "A ChainedBuffer must not convert to a Buffer!");
+  static_assert(!std::is_convertible<ChainedBuffer*, const Buffer*>::value, "A ChainedBuffer must not convert to a Buffer!");
+
+  ChainedBuffer *buffer = new ChainedBuffer(16);
+  for (uint32_t i = 0; i < 12; i++)
+  {
+    buffer->write_uint32(i);
+  }
+
+  ASSERT_EQ(buffer->get_segment_count(), 3);
+
+  // the whole chain is read, not just the current segment
+  ChainedBufferIterator *buffer_iterator = new ChainedBufferIterator(buffer);
+  for (uint32_t i = 0; i < 12; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint32(), i);
+  }
+
+  ASSERT_EQ(buffer_iterator->get_remaining_size(), 0);
+  EXPECT_THROW(buffer_iterator->read_uint8(), std::runtime_error);
+
+  delete buffer_iterator;
+  delete buffer;
+}
+
+TEST(ChainedBufferTests, set_allocator_with_segments)
+{
+  PoolAllocator allocator;
+  ChainedBuffer *buffer = new ChainedBuffer(&allocator);
+  buffer->write_uint32(42);
+
+  // the segments must go back to the allocator they came from
+  EXPECT_THROW(buffer->set_allocator(BufferAllocator::get_default()), std::runtime_error);
+  EXPECT_EQ(buffer->get_allocator(), &allocator);
+
+  buffer->clear();
+  buffer->set_allocator(BufferAllocator::get_default());
+  buffer->write_uint32(43);
+  EXPECT_EQ(buffer->get_allocator(), BufferAllocator::get_default());
+
+  delete buffer;
+}
+
+TEST(ChainedBufferTests, mark_and_slot_across_segments)
+{
+  ChainedBuffer *buffer = new ChainedBuffer(16);
+  buffer->write_uint64(1);
+
+  // within a segment marks and slots work as they do on any buffer
+  BufferMark mark = buffer->mark();
+  BufferSlot<uint32_t> slot = buffer->reserve_slot<uint32_t>();
+  buffer->write_uint32(3);
+  buffer->patch(slot, 2u);
+  buffer->rewind(mark);
+  ASSERT_EQ(buffer->get_total_size(), 8);
+
+  // once the chain moves to a new segment they refer to bytes that
+  // are no longer in the current one, so they are refused
+  slot = buffer->reserve_slot<uint32_t>();
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    buffer->write_uint32(i);
+  }
+
+  ASSERT_EQ(buffer->get_segment_count(), 2);
+  EXPECT_THROW(buffer->rewind(mark), std::runtime_error);
+  EXPECT_THROW(buffer->patch(slot, 2u), std::runtime_error);
+  ASSERT_EQ(buffer->get_total_size(), 28);
+
+  delete buffer;
+}
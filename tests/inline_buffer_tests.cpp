@@ -0,0 +1,122 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "inline_buffer.hpp"
+
+TEST(InlineBufferTests, write_inline)
+{
+  ArenaAllocator *allocator = new ArenaAllocator();
+  InlineBuffer<64> *buffer = new InlineBuffer<64>(allocator);
+
+  buffer->write_uint32(42);
+  buffer->write_string("A quick brown fox jumps over the lazy dog.");
+  EXPECT_TRUE(buffer->is_inline());
+  ASSERT_EQ(buffer->get_capacity(), 64);
+  ASSERT_EQ(allocator->get_used_size(), 0);
+
+  // the bytes live inside the object itself
+  const uint8_t *begin = (const uint8_t*)buffer;
+  EXPECT_TRUE(buffer->get_data() >= begin && buffer->get_data() < begin + sizeof(InlineBuffer<64>));
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint32(), 42);
+  ASSERT_EQ(buffer_iterator->read_string(), "A quick brown fox jumps over the lazy dog.");
+
+  delete buffer_iterator;
+  delete buffer;
+  delete allocator;
+}
+
+TEST(InlineBufferTests, spill)
+{
+  InlineBuffer<16> *buffer = new InlineBuffer<16>();
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    buffer->write_uint32(i);
+  }
+
+  EXPECT_TRUE(buffer->is_inline());
+
+  // the next write no longer fits and moves the data to the heap
+  buffer->write_uint32(4);
+  EXPECT_FALSE(buffer->is_inline());
+  EXPECT_FALSE(buffer->is_borrowed());
+  ASSERT_EQ(buffer->get_size(), 20);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  for (uint32_t i = 0; i < 5; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint32(), i);
+  }
+
+  // clearing returns to the inline storage
+  buffer->clear();
+  EXPECT_TRUE(buffer->is_inline());
+  ASSERT_EQ(buffer->get_size(), 0);
+
+  delete buffer_iterator;
+  delete buffer;
+}
+
+TEST(InlineBufferTests, move)
+{
+  InlineBuffer<32> buffer;
+  buffer.write_uint64(7);
+
+  InlineBuffer<32> other_buffer(std::move(buffer));
+  EXPECT_TRUE(other_buffer.is_inline());
+  ASSERT_EQ(other_buffer.get_size(), 8);
+  ASSERT_EQ(buffer.get_size(), 0);
+
+  // moving into a plain buffer copies the inline bytes out
+  Buffer heap_buffer(std::move(other_buffer));
+  ASSERT_EQ(heap_buffer.get_size(), 8);
+  ASSERT_EQ(other_buffer.get_size(), 0);
+
+  BufferIterator buffer_iterator(&heap_buffer);
+  ASSERT_EQ(buffer_iterator.read_uint64(), 7);
+
+  // a spilled buffer hands over its heap data
+  InlineBuffer<4> spilled_buffer;
+  spilled_buffer.write_uint64(9);
+  const uint8_t *data = spilled_buffer.get_data();
+  InlineBuffer<4> other_spilled_buffer;
+  other_spilled_buffer = std::move(spilled_buffer);
+  EXPECT_TRUE(other_spilled_buffer.get_data() == data);
+  EXPECT_TRUE(spilled_buffer.is_inline());
+
+  EXPECT_THROW(heap_buffer.swap(spilled_buffer), std::runtime_error);
+}
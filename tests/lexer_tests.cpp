@@ -31,11 +31,50 @@
 #include <string>
 #include <sstream>
 #include <limits>
+#include <vector>
+#include <atomic>
+#include <new>
 
 #include <gtest/gtest.h>
 
 #include "lexer.hpp"
 
+// counts every allocation made through operator new in the test binary,
+// so a test can show that a code path makes none without trusting it
+static std::atomic<size_t> allocation_count(0);
+
+// none of these are inlined, gcc would otherwise see malloc() and free()
+// paired with the other side's operator and warn about a mismatch
+__attribute__((noinline))
+void* operator new(size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void *data = malloc(size > 0 ? size : 1);
+  if (data == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+
+  return data;
+}
+
+__attribute__((noinline))
+void operator delete(void *data) noexcept
+{
+  free(data);
+}
+
+__attribute__((noinline))
+void operator delete(void *data, size_t size) noexcept
+{
+  free(data);
+}
+
+static size_t get_allocation_count()
+{
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
 TEST(LexerTests, parse_string_token_single_quote)
 {
   std::istringstream stream("\'Hello World!\'");
@@ -281,3 +320,555 @@ TEST(LexerTests, parse_number_token_double)
 
   delete token;
 }
+
+TEST(LexerTests, parse_span)
+{
+  std::string source = "message Point\n{\n  x 'first value' 1.5\n  y \"second\" -42\n}\n";
+  Lexer lexer(source.c_str(), source.size());
+
+  const char *names[] = { "message", "Point", "x" };
+  size_t linenos[] = { 1, 1, 3 };
+  for (size_t i = 0; i < 3; i++)
+  {
+    const LexerToken *token = lexer.read();
+    ASSERT_TRUE(token != nullptr);
+    ASSERT_EQ(token->get_type(), LEXER_TOKEN_NAME);
+    ASSERT_EQ(((LexerToken*)token)->get_lineno(), linenos[i]);
+
+    // tokens own a copy of their text, only records point into the source
+    const NameToken *name_token = token->as_name_token();
+    EXPECT_TRUE(name_token->get_view().compare(names[i]));
+    EXPECT_TRUE(name_token->owns_value());
+    delete token;
+  }
+
+  const LexerToken *token = lexer.read();
+  ASSERT_EQ(token->get_type(), LEXER_TOKEN_STRING);
+  EXPECT_TRUE(token->as_string_token()->get_view().compare("first value"));
+  ASSERT_EQ(((LexerToken*)token)->get_begin_pos(), 4);
+  delete token;
+
+  token = lexer.read();
+  ASSERT_EQ(token->get_type(), LEXER_TOKEN_NUMBER);
+  ASSERT_EQ(token->as_number_token()->get_value_type(), LEXER_INT_FLOAT);
+  ASSERT_EQ(token->as_number_token()->get_float(), 1.5f);
+  delete token;
+
+  token = lexer.read();
+  EXPECT_TRUE(token->as_name_token()->get_value().compare("y") == 0);
+  ASSERT_EQ(lexer.get_current_lineno(), 4);
+  EXPECT_TRUE(lexer.get_current_line().compare("  y \"second\" -42") == 0);
+  delete token;
+
+  token = lexer.read();
+  EXPECT_TRUE(token->as_string_token()->get_value().compare("second") == 0);
+  delete token;
+
+  token = lexer.read();
+  ASSERT_EQ(token->get_type(), LEXER_TOKEN_NUMBER);
+  EXPECT_TRUE(token->as_number_token()->get_is_negative());
+  delete token;
+
+  ASSERT_TRUE(lexer.read() == nullptr);
+}
+
+TEST(LexerTests, set_current_line)
+{
+  std::string source = "aaa\nbbb\nccc";
+  Lexer lexer(source.c_str(), source.size());
+  ASSERT_EQ(lexer.get_current_lineno(), 0);
+
+  const LexerToken *token = lexer.read();
+  EXPECT_TRUE(token->as_name_token()->get_value().compare("aaa") == 0);
+  ASSERT_EQ(lexer.get_current_lineno(), 1);
+  delete token;
+
+  // the new line replaces the current one, the lines after it are kept
+  lexer.set_current_line("zzz yyy");
+  ASSERT_EQ(lexer.get_current_offset(), 3);
+  EXPECT_TRUE(lexer.get_current_line().compare("zzz yyy") == 0);
+
+  const char *names[] = { "yyy", "bbb", "ccc" };
+  size_t linenos[] = { 1, 2, 3 };
+  for (size_t i = 0; i < 3; i++)
+  {
+    token = lexer.read();
+    ASSERT_TRUE(token != nullptr);
+    EXPECT_TRUE(token->as_name_token()->get_value().compare(names[i]) == 0);
+    ASSERT_EQ(((LexerToken*)token)->get_lineno(), linenos[i]);
+    delete token;
+  }
+
+  ASSERT_TRUE(lexer.read() == nullptr);
+  EXPECT_TRUE(source.compare("aaa\nbbb\nccc") == 0);
+}
+
+TEST(LexerTests, tokens_outlive_lexer)
+{
+  std::istringstream stream("name 'a string'");
+  Lexer *lexer = new Lexer(stream);
+
+  const LexerToken *name_token = lexer->read();
+  const LexerToken *string_token = lexer->read();
+  ASSERT_TRUE(name_token != nullptr);
+  ASSERT_TRUE(string_token != nullptr);
+  delete lexer;
+
+  // the lexer's copy of the stream is gone, the tokens have their own
+  EXPECT_TRUE(name_token->as_name_token()->get_value().compare("name") == 0);
+  EXPECT_TRUE(string_token->as_string_token()->get_value().compare("a string") == 0);
+
+  delete name_token;
+  delete string_token;
+}
+
+TEST(LexerTests, copy_string_tokens)
+{
+  std::vector<StringToken> tokens;
+  for (size_t i = 0; i < 32; i++)
+  {
+    StringToken token(nullptr, 1, 0, 0);
+    token.set_value(std::string(i + 20, (char)('a' + i % 26)));
+    tokens.push_back(token);
+  }
+
+  // copies view their own strings, not the ones they were copied from
+  for (size_t i = 0; i < tokens.size(); i++)
+  {
+    std::string value(i + 20, (char)('a' + i % 26));
+    ASSERT_EQ(tokens[i].get_value(), value);
+    EXPECT_TRUE(tokens[i].get_view().compare(value));
+  }
+}
+
+TEST(LexerTests, parse_buffer)
+{
+  Buffer buffer;
+  std::string source = "'a' 'b' name";
+  buffer.write((const uint8_t*)source.c_str(), source.size());
+
+  // the closing quote ends a string, it does not start the next one
+  Lexer lexer(&buffer);
+  const char *values[] = { "a", "b", "name" };
+  for (size_t i = 0; i < 3; i++)
+  {
+    const LexerToken *token = lexer.read();
+    ASSERT_TRUE(token != nullptr);
+    EXPECT_TRUE(token->as_string_token()->get_view().compare(values[i]));
+    delete token;
+  }
+
+  ASSERT_TRUE(lexer.read() == nullptr);
+}
+
+TEST(LexerTests, parse_unterminated_string)
+{
+  std::string source = "'abc\n'";
+  Lexer lexer(source.c_str(), source.size());
+  EXPECT_THROW(lexer.read(), std::runtime_error);
+
+  std::string other_source = "\"abc";
+  Lexer other_lexer(other_source.c_str(), other_source.size());
+  EXPECT_THROW(other_lexer.read(), std::runtime_error);
+}
+
+TEST(LexerTests, tokenize_records)
+{
+  std::string source = "name 'str' 255 -70000 2.5\nnext";
+  Lexer lexer(source.c_str(), source.size());
+
+  std::vector<LexerTokenRecord> records;
+  ASSERT_EQ(lexer.tokenize(records), 6);
+  ASSERT_EQ(records.size(), 6);
+
+  ASSERT_EQ(records[0].type, LEXER_TOKEN_NAME);
+  EXPECT_TRUE(records[0].get_view().compare("name"));
+  ASSERT_EQ(records[0].begin_pos, 0);
+  ASSERT_EQ(records[0].end_pos, 4);
+
+  ASSERT_EQ(records[1].type, LEXER_TOKEN_STRING);
+  EXPECT_TRUE(records[1].get_view().compare("str"));
+
+  ASSERT_EQ(records[2].type, LEXER_TOKEN_NUMBER);
+  ASSERT_EQ(records[2].value_type, LEXER_INT_UINT8);
+  ASSERT_EQ(records[2].value.uint8_value, 255);
+
+  ASSERT_EQ(records[3].type, LEXER_TOKEN_NUMBER);
+  ASSERT_EQ(records[3].value_type, LEXER_INT_INT32);
+  ASSERT_EQ(records[3].value.int32_value, -70000);
+  EXPECT_TRUE(records[3].is_negative);
+  EXPECT_TRUE(records[3].get_view().compare("-70000"));
+
+  ASSERT_EQ(records[4].type, LEXER_TOKEN_NUMBER);
+  ASSERT_EQ(records[4].value_type, LEXER_INT_FLOAT);
+  ASSERT_EQ(records[4].value.float_value, 2.5f);
+  EXPECT_TRUE(records[4].is_floating_point);
+
+  ASSERT_EQ(records[5].type, LEXER_TOKEN_NAME);
+  ASSERT_EQ(records[5].lineno, 2);
+  ASSERT_EQ(records[5].begin_pos, 0);
+
+  // the vector is reused, tokens are appended to it
+  LexerTokenRecord record;
+  EXPECT_FALSE(lexer.next(record));
+  ASSERT_EQ(lexer.tokenize(records), 0);
+  ASSERT_EQ(records.size(), 6);
+}
+
+TEST(LexerTests, records_match_tokens)
+{
+  std::string source = "a 'b' 1 -2 3.5 c_d \"e\" 65536";
+  Lexer lexer(source.c_str(), source.size());
+  Lexer other_lexer(source.c_str(), source.size());
+
+  LexerTokenRecord record;
+  while (lexer.next(record))
+  {
+    const LexerToken *token = other_lexer.read();
+    ASSERT_TRUE(token != nullptr);
+    ASSERT_EQ(token->get_type(), record.type);
+    ASSERT_EQ(((LexerToken*)token)->get_begin_pos(), record.begin_pos);
+    ASSERT_EQ(((LexerToken*)token)->get_end_pos(), record.end_pos);
+    if (record.type == LEXER_TOKEN_NUMBER)
+    {
+      ASSERT_EQ(token->as_number_token()->get_value_type(), record.value_type);
+    }
+    else
+    {
+      EXPECT_TRUE(token->as_string_token()->get_view().compare(record.get_view()));
+    }
+
+    delete token;
+  }
+
+  ASSERT_TRUE(other_lexer.read() == nullptr);
+}
+
+TEST(LexerTests, number_token_inline_value)
+{
+  std::string source = "-5 -1.5 -300 7";
+  Lexer lexer(source.c_str(), source.size());
+
+  const LexerToken *token = lexer.read();
+  ASSERT_TRUE(token != nullptr);
+  ASSERT_EQ(token->as_number_token()->get_value_type(), LEXER_INT_INT8);
+  ASSERT_EQ(token->as_number_token()->get_int8(), -5);
+  delete token;
+
+  token = lexer.read();
+  ASSERT_TRUE(token != nullptr);
+  ASSERT_EQ(token->as_number_token()->get_value_type(), LEXER_INT_FLOAT);
+  ASSERT_EQ(token->as_number_token()->get_float(), -1.5f);
+  delete token;
+
+  token = lexer.read();
+  ASSERT_TRUE(token != nullptr);
+  ASSERT_EQ(token->as_number_token()->get_value_type(), LEXER_INT_INT16);
+  ASSERT_EQ(token->as_number_token()->get_int16(), -300);
+  delete token;
+
+  // a wider read of a narrow value does not reach past the value
+  token = lexer.read();
+  ASSERT_TRUE(token != nullptr);
+  ASSERT_EQ(token->as_number_token()->get_value_type(), LEXER_INT_UINT8);
+  ASSERT_EQ(token->as_number_token()->get_uint64(), 7);
+  ASSERT_EQ(*token->as_number_token()->get_value(), 7);
+  delete token;
+}
+
+TEST(LexerTests, numbers_do_not_allocate)
+{
+  std::string source = "1 -2 3.5 65536 -9223372036854775808 18446744073709551615 0.0";
+  Lexer lexer(source.c_str(), source.size());
+
+  // every operator new in the process is counted, not just the ones the
+  // lexer knows about, so the check holds for anything scanning calls
+  LexerTokenRecord record;
+  uint8_t types[8] = {};
+  size_t count = 0;
+  size_t allocation_count = get_allocation_count();
+  while (count < 8 && lexer.next(record))
+  {
+    types[count++] = record.type;
+  }
+
+  ASSERT_EQ(get_allocation_count(), allocation_count);
+  ASSERT_EQ(count, 7);
+  for (size_t i = 0; i < count; i++)
+  {
+    ASSERT_EQ(types[i], LEXER_TOKEN_NUMBER);
+  }
+
+  // the token classes take a single allocation for the token itself,
+  // and the value is stored inside of it
+  Lexer token_lexer(source.c_str(), source.size());
+  allocation_count = get_allocation_count();
+  const LexerToken *token = nullptr;
+  while ((token = token_lexer.read()) != nullptr)
+  {
+    const uint8_t *value = token->as_number_token()->get_value();
+    EXPECT_TRUE(value >= (const uint8_t*)token && value < (const uint8_t*)token + sizeof(NumberToken));
+    delete token;
+  }
+
+  ASSERT_EQ(get_allocation_count(), allocation_count + 7);
+}
+
+TEST(LexerTests, parse_number_out_of_range)
+{
+  std::string source = "18446744073709551616";
+  Lexer lexer(source.c_str(), source.size());
+
+  LexerTokenRecord record;
+  EXPECT_THROW(lexer.next(record), std::runtime_error);
+}
+
+TEST(LexerTests, scan_long_runs)
+{
+  // runs that end at every position of a vector and at every byte value
+  for (size_t length = 1; length < 70; length++)
+  {
+    for (int c = 1; c < 256; c++)
+    {
+      std::string name(length, 'a');
+      name[length / 2] = 'Z';
+      name[length - 1] = '_';
+      std::string source = name + (char)c + "  ";
+
+      Lexer lexer(source.c_str(), source.size());
+      LexerTokenRecord record;
+      ASSERT_TRUE(lexer.next(record));
+      ASSERT_EQ(record.type, LEXER_TOKEN_NAME);
+
+      bool is_name = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+      ASSERT_EQ(record.size, is_name ? length + 1 : length) << "length: " << length << " char: " << c;
+    }
+  }
+
+  for (size_t length = 1; length < 70; length++)
+  {
+    for (int c = 1; c < 256; c++)
+    {
+      // a fraction keeps the long runs within the range of a double
+      std::string source = "0." + std::string(length, '7') + (char)c + "  ";
+
+      Lexer lexer(source.c_str(), source.size());
+      LexerTokenRecord record;
+      ASSERT_TRUE(lexer.next(record));
+      ASSERT_EQ(record.type, LEXER_TOKEN_NUMBER);
+
+      bool is_digit = c >= '0' && c <= '9';
+      ASSERT_EQ(record.size, is_digit ? length + 3 : length + 2) << "length: " << length << " char: " << c;
+    }
+  }
+}
+
+TEST(LexerTests, skip_long_runs)
+{
+  for (size_t length = 1; length < 70; length++)
+  {
+    std::string gap;
+    for (size_t i = 0; i < length; i++)
+    {
+      gap += " \t!,;:(){}[]<>=+*/\r\x80\xff"[i % 20];
+    }
+
+    std::string source = gap + "\n" + gap + ". .x" + gap + "name" + gap + "\n" + gap + "42" + gap;
+    Lexer lexer(source.c_str(), source.size());
+
+    LexerTokenRecord record;
+    ASSERT_TRUE(lexer.next(record));
+    ASSERT_EQ(record.type, LEXER_TOKEN_NAME);
+    EXPECT_TRUE(record.get_view().compare("x"));
+    ASSERT_EQ(record.lineno, 2);
+    ASSERT_EQ(record.begin_pos, length + 3);
+
+    ASSERT_TRUE(lexer.next(record));
+    EXPECT_TRUE(record.get_view().compare("name"));
+
+    ASSERT_TRUE(lexer.next(record));
+    ASSERT_EQ(record.type, LEXER_TOKEN_NUMBER);
+    ASSERT_EQ(record.value.uint8_value, 42);
+    ASSERT_EQ(record.lineno, 3);
+    ASSERT_EQ(record.begin_pos, length);
+    ASSERT_FALSE(lexer.next(record));
+  }
+}
+
+TEST(LexerTests, scan_long_numbers)
+{
+  std::string source = "12345678901234567890123456789012345.5 1234567890123456789 .25";
+  Lexer lexer(source.c_str(), source.size());
+
+  LexerTokenRecord record;
+  ASSERT_TRUE(lexer.next(record));
+  EXPECT_TRUE(record.is_floating_point);
+  ASSERT_EQ(record.size, 37);
+
+  ASSERT_TRUE(lexer.next(record));
+  ASSERT_EQ(record.value_type, LEXER_INT_UINT64);
+  ASSERT_EQ(record.value.uint64_value, 1234567890123456789ull);
+
+  ASSERT_TRUE(lexer.next(record));
+  EXPECT_TRUE(record.is_floating_point);
+  EXPECT_TRUE(record.get_view().compare(".25"));
+  ASSERT_FALSE(lexer.next(record));
+}
+
+TEST(LexerTests, parse_malformed_number)
+{
+  const char *sources[] = {
+    "1.2.3",
+    ".25.5",
+    "-1.2.3"
+  };
+
+  for (const char *source : sources)
+  {
+    Lexer lexer(source, strlen(source));
+    LexerTokenRecord record;
+    EXPECT_THROW(lexer.next(record), std::runtime_error) << source;
+  }
+}
+
+TEST(LexerTests, parse_zero_padded_numbers)
+{
+  // numbers are always decimal, a leading zero does not make them octal
+  std::string source = "2019-08-09 007";
+  Lexer lexer(source.c_str(), source.size());
+
+  LexerTokenRecord record;
+  ASSERT_TRUE(lexer.next(record));
+  ASSERT_EQ(record.value_type, LEXER_INT_UINT16);
+  ASSERT_EQ(record.value.uint16_value, 2019);
+
+  ASSERT_TRUE(lexer.next(record));
+  ASSERT_EQ(record.value_type, LEXER_INT_INT8);
+  ASSERT_EQ(record.value.int8_value, -8);
+
+  ASSERT_TRUE(lexer.next(record));
+  ASSERT_EQ(record.value_type, LEXER_INT_INT8);
+  ASSERT_EQ(record.value.int8_value, -9);
+
+  ASSERT_TRUE(lexer.next(record));
+  ASSERT_EQ(record.value_type, LEXER_INT_UINT8);
+  ASSERT_EQ(record.value.uint8_value, 7);
+
+  ASSERT_FALSE(lexer.next(record));
+}
+
+TEST(LexerTests, parse_string_escapes)
+{
+  std::string source = "'it\\'s' \"a \\\"b\\\" \\\\ \\n\\t\\r\\x41\\x7a\" 'don\"t' \"plain\"";
+  Lexer lexer(source.c_str(), source.size());
+
+  const LexerToken *token = lexer.read();
+  ASSERT_TRUE(token != nullptr);
+  EXPECT_TRUE(token->as_string_token()->get_value().compare("it's") == 0);
+  delete token;
+
+  token = lexer.read();
+  ASSERT_TRUE(token != nullptr);
+  EXPECT_TRUE(token->as_string_token()->get_value().compare("a \"b\" \\ \n\t\rAz") == 0);
+  delete token;
+
+  // the other kind of quote does not end a string
+  token = lexer.read();
+  ASSERT_TRUE(token != nullptr);
+  EXPECT_TRUE(token->as_string_token()->get_value().compare("don\"t") == 0);
+  delete token;
+
+  token = lexer.read();
+  ASSERT_TRUE(token != nullptr);
+  EXPECT_TRUE(token->as_string_token()->get_view().compare("plain"));
+  EXPECT_TRUE(token->as_string_token()->owns_value());
+  delete token;
+
+  ASSERT_TRUE(lexer.read() == nullptr);
+}
+
+TEST(LexerTests, decode_string_record)
+{
+  std::string source = "'\\0\\x00end' 'raw'";
+  Lexer lexer(source.c_str(), source.size());
+
+  LexerTokenRecord record;
+  ASSERT_TRUE(lexer.next(record));
+  EXPECT_TRUE(record.has_escapes);
+  EXPECT_TRUE(record.get_view().compare("\\0\\x00end"));
+
+  std::string value = Lexer::decode_string(record);
+  ASSERT_EQ(value.size(), 5);
+  ASSERT_EQ(value, std::string("\0\0end", 5));
+
+  ASSERT_TRUE(lexer.next(record));
+  EXPECT_FALSE(record.has_escapes);
+  ASSERT_EQ(Lexer::decode_string(record), "raw");
+}
+
+TEST(LexerTests, parse_invalid_string)
+{
+  const char *sources[] = {
+    "'abc\\'",
+    "'abc\\",
+    "'abc\\\n'",
+    "'abc\\q'",
+    "'abc\\x4'",
+    "'abc\\xg0'",
+    "\"abc'",
+    "'abc\""
+  };
+
+  for (const char *source : sources)
+  {
+    Lexer lexer(source, strlen(source));
+    LexerTokenRecord record;
+    EXPECT_THROW(lexer.next(record), std::runtime_error) << source;
+  }
+}
+
+TEST(LexerTests, scan_long_strings)
+{
+  // strings that stop at every position of a vector
+  for (size_t length = 0; length < 70; length++)
+  {
+    for (char c : std::string("\"'\\\n"))
+    {
+      std::string text(length, 'x');
+      std::string source = "\"" + text + c;
+      if (c != '"')
+      {
+        source += c == '\\' ? "\"\"" : "\"";
+      }
+
+      Lexer lexer(source.c_str(), source.size());
+      LexerTokenRecord record;
+      if (c == '\n')
+      {
+        EXPECT_THROW(lexer.next(record), std::runtime_error);
+        continue;
+      }
+
+      ASSERT_TRUE(lexer.next(record));
+      ASSERT_EQ(record.type, LEXER_TOKEN_STRING);
+      if (c == '"')
+      {
+        ASSERT_EQ(record.size, length);
+        EXPECT_FALSE(record.has_escapes);
+      }
+      else if (c == '\'')
+      {
+        ASSERT_EQ(record.size, length + 1);
+        EXPECT_FALSE(record.has_escapes);
+      }
+      else
+      {
+        ASSERT_EQ(record.size, length + 2);
+        EXPECT_TRUE(record.has_escapes);
+        ASSERT_EQ(Lexer::decode_string(record), text + "\"");
+      }
+
+      ASSERT_FALSE(lexer.next(record));
+    }
+  }
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+#include "mapped_buffer.hpp"
+
+static std::string get_mapped_file_path(const std::string &name)
+{
+  return ::testing::TempDir() + "serialbuf_" + name;
+}
+
+TEST(MappedBufferTests, write_and_read)
+{
+  std::string path = get_mapped_file_path("write_and_read.bin");
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+
+  MappedBuffer *buffer = new MappedBuffer(path, MAPPED_BUFFER_WRITE);
+  EXPECT_TRUE(buffer->is_open());
+  for (uint32_t i = 0; i < 100000; i++)
+  {
+    buffer->write_uint32(i);
+    buffer->write_string(str);
+  }
+
+  size_t size = buffer->get_size();
+  buffer->sync();
+  delete buffer;
+
+  MappedBuffer *mapped_buffer = new MappedBuffer(path, MAPPED_BUFFER_READ);
+  ASSERT_EQ(mapped_buffer->get_size(), size);
+
+  BufferIterator *buffer_iterator = new BufferIterator(mapped_buffer);
+  for (uint32_t i = 0; i < 100000; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint32(), i);
+    EXPECT_TRUE(buffer_iterator->read_string_view().compare(str));
+  }
+
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete mapped_buffer;
+  delete buffer_iterator;
+  remove(path.c_str());
+}
+
+TEST(MappedBufferTests, read_empty_file)
+{
+  std::string path = get_mapped_file_path("read_empty_file.bin");
+
+  MappedBuffer *buffer = new MappedBuffer(path, MAPPED_BUFFER_WRITE);
+  buffer->close();
+  EXPECT_FALSE(buffer->is_open());
+
+  buffer->open(path, MAPPED_BUFFER_READ);
+  EXPECT_TRUE(buffer->is_open());
+  ASSERT_EQ(buffer->get_size(), 0);
+
+  delete buffer;
+  remove(path.c_str());
+}
+
+TEST(MappedBufferTests, read_copies_on_write)
+{
+  std::string path = get_mapped_file_path("read_copies_on_write.bin");
+
+  MappedBuffer *buffer = new MappedBuffer(path, MAPPED_BUFFER_WRITE);
+  buffer->write_uint64(std::numeric_limits<uint64_t>::max());
+  delete buffer;
+
+  MappedBuffer *mapped_buffer = new MappedBuffer(path, MAPPED_BUFFER_READ);
+  mapped_buffer->write_uint64(0);
+  EXPECT_FALSE(mapped_buffer->is_borrowed());
+  delete mapped_buffer;
+
+  // the file itself is left untouched
+  mapped_buffer = new MappedBuffer(path, MAPPED_BUFFER_READ);
+  BufferIterator *buffer_iterator = new BufferIterator(mapped_buffer);
+  ASSERT_EQ(buffer_iterator->read_uint64(), std::numeric_limits<uint64_t>::max());
+
+  delete mapped_buffer;
+  delete buffer_iterator;
+  remove(path.c_str());
+}
+
+TEST(MappedBufferTests, move_copies_mapping)
+{
+  std::string path = get_mapped_file_path("move_copies_mapping.bin");
+
+  MappedBuffer *buffer = new MappedBuffer(path, MAPPED_BUFFER_WRITE);
+  buffer->write_uint32(42);
+  buffer->write_uint32(43);
+  delete buffer;
+
+  // the moved bytes outlive the mapping they came from
+  Buffer moved_buffer;
+  {
+    MappedBuffer mapped_buffer(path, MAPPED_BUFFER_READ);
+    moved_buffer = std::move(mapped_buffer);
+    EXPECT_EQ(mapped_buffer.get_size(), 0);
+  }
+
+  EXPECT_FALSE(moved_buffer.is_borrowed());
+  ASSERT_EQ(moved_buffer.get_size(), 8);
+
+  BufferIterator buffer_iterator(&moved_buffer);
+  ASSERT_EQ(buffer_iterator.read_uint32(), 42);
+  ASSERT_EQ(buffer_iterator.read_uint32(), 43);
+
+  // swapping the mapping away is refused outright
+  MappedBuffer mapped_buffer(path, MAPPED_BUFFER_READ);
+  Buffer other_buffer;
+  EXPECT_THROW(other_buffer.swap(mapped_buffer), std::runtime_error);
+  EXPECT_EQ(mapped_buffer.get_size(), 8);
+
+  remove(path.c_str());
+}
+
+TEST(MappedBufferTests, open_missing_file)
+{
+  EXPECT_THROW(MappedBuffer(get_mapped_file_path("missing/file.bin"), MAPPED_BUFFER_READ), std::runtime_error);
+}
@@ -0,0 +1,204 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "chained_buffer.hpp"
+#include "inline_buffer.hpp"
+#include "mapped_buffer.hpp"
+#include "shared_buffer.hpp"
+
+TEST(SharedBufferTests, freeze)
+{
+  Buffer *buffer = new Buffer();
+  buffer->write_uint32(42);
+  buffer->write_string("A quick brown fox jumps over the lazy dog.");
+  const uint8_t *data = buffer->get_data();
+  size_t size = buffer->get_size();
+
+  // freezing takes over the storage without copying it
+  SharedBuffer *shared_buffer = new SharedBuffer(std::move(*buffer));
+  EXPECT_TRUE(shared_buffer->get_data() == data);
+  ASSERT_EQ(shared_buffer->get_size(), size);
+  ASSERT_EQ(shared_buffer->get_use_count(), 1);
+  ASSERT_EQ(buffer->get_size(), 0);
+  delete buffer;
+
+  BufferIterator *buffer_iterator = new BufferIterator(shared_buffer->get_buffer());
+  ASSERT_EQ(buffer_iterator->read_uint32(), 42);
+  ASSERT_EQ(buffer_iterator->read_string(), "A quick brown fox jumps over the lazy dog.");
+
+  delete buffer_iterator;
+  delete shared_buffer;
+}
+
+TEST(SharedBufferTests, freeze_inline)
+{
+  InlineBuffer<32> buffer;
+  buffer.write_uint64(7);
+
+  // inline bytes stay with the buffer, so they are copied
+  SharedBuffer shared_buffer(std::move(buffer));
+  EXPECT_TRUE(shared_buffer.get_data() != buffer.get_data());
+  ASSERT_EQ(shared_buffer.get_size(), 8);
+
+  BufferIterator buffer_iterator(shared_buffer.get_buffer());
+  ASSERT_EQ(buffer_iterator.read_uint64(), 7);
+}
+
+TEST(SharedBufferTests, freeze_mapped)
+{
+  std::string path = ::testing::TempDir() + "serialbuf_freeze_mapped.bin";
+  MappedBuffer *buffer = new MappedBuffer(path, MAPPED_BUFFER_WRITE);
+  buffer->write_uint32(42);
+  buffer->write_string("A quick brown fox jumps over the lazy dog.");
+  size_t size = buffer->get_size();
+
+  // the mapping stays with the file, so the bytes are copied and the
+  // file keeps everything that was written to it
+  SharedBuffer shared_buffer(std::move(*buffer));
+  EXPECT_TRUE(shared_buffer.get_data() != buffer->get_data());
+  ASSERT_EQ(shared_buffer.get_size(), size);
+  ASSERT_EQ(buffer->get_size(), size);
+  buffer->close();
+  delete buffer;
+
+  MappedBuffer *mapped_buffer = new MappedBuffer(path, MAPPED_BUFFER_READ);
+  ASSERT_EQ(mapped_buffer->get_size(), size);
+
+  BufferIterator buffer_iterator(shared_buffer.get_buffer());
+  ASSERT_EQ(buffer_iterator.read_uint32(), 42);
+  ASSERT_EQ(buffer_iterator.read_string(), "A quick brown fox jumps over the lazy dog.");
+
+  BufferIterator mapped_buffer_iterator(mapped_buffer);
+  ASSERT_EQ(mapped_buffer_iterator.read_uint32(), 42);
+
+  delete mapped_buffer;
+  remove(path.c_str());
+}
+
+TEST(SharedBufferTests, freeze_chained)
+{
+  ChainedBuffer chain(16);
+  for (uint32_t i = 0; i < 12; i++)
+  {
+    chain.write_uint32(i);
+  }
+
+  ASSERT_EQ(chain.get_segment_count(), 3);
+
+  // every segment is joined into the frozen buffer, not just the last one
+  SharedBuffer shared_buffer(std::move(chain));
+  ASSERT_EQ(shared_buffer.get_size(), 48);
+  ASSERT_EQ(chain.get_total_size(), 0);
+
+  BufferIterator buffer_iterator(shared_buffer.get_buffer());
+  for (uint32_t i = 0; i < 12; i++)
+  {
+    ASSERT_EQ(buffer_iterator.read_uint32(), i);
+  }
+
+  ASSERT_EQ(buffer_iterator.get_remaining_size(), 0);
+}
+
+TEST(SharedBufferTests, fan_out)
+{
+  Buffer buffer;
+  for (uint32_t i = 0; i < 100; i++)
+  {
+    buffer.write_uint32(i);
+  }
+
+  SharedBuffer shared_buffer(std::move(buffer));
+
+  // every copy shares the same bytes and holds its own reference
+  std::vector<SharedBuffer> shared_buffers;
+  for (size_t i = 0; i < 10; i++)
+  {
+    shared_buffers.push_back(shared_buffer);
+  }
+
+  ASSERT_EQ(shared_buffer.get_use_count(), 11);
+  for (const SharedBuffer &other_shared_buffer : shared_buffers)
+  {
+    EXPECT_TRUE(other_shared_buffer.get_data() == shared_buffer.get_data());
+
+    BufferIterator buffer_iterator(other_shared_buffer.get_buffer());
+    for (uint32_t i = 0; i < 100; i++)
+    {
+      ASSERT_EQ(buffer_iterator.read_uint32(), i);
+    }
+  }
+
+  // the data outlives the buffer it was frozen from
+  SharedBuffer last_shared_buffer = shared_buffers.back();
+  shared_buffers.clear();
+  shared_buffer.clear();
+  ASSERT_EQ(last_shared_buffer.get_use_count(), 1);
+
+  BufferIterator buffer_iterator(last_shared_buffer.get_buffer());
+  ASSERT_EQ(buffer_iterator.read_uint32(), 0);
+}
+
+TEST(SharedBufferTests, slice)
+{
+  Buffer buffer;
+  for (uint32_t i = 0; i < 100; i++)
+  {
+    buffer.write_uint32(i);
+  }
+
+  SharedBuffer shared_buffer(std::move(buffer));
+  SharedBuffer slice = shared_buffer.slice(40, 8);
+  ASSERT_EQ(slice.get_size(), 8);
+  ASSERT_EQ(shared_buffer.get_use_count(), 2);
+
+  BufferIterator buffer_iterator(slice.get_buffer());
+  ASSERT_EQ(buffer_iterator.read_uint32(), 10);
+  ASSERT_EQ(buffer_iterator.read_uint32(), 11);
+  EXPECT_THROW(buffer_iterator.read_uint32(), std::runtime_error);
+
+  // slices of slices are relative to the slice
+  SharedBuffer other_slice = slice.slice(4, 4);
+  EXPECT_TRUE(other_slice.get_view().compare(BufferView(shared_buffer.get_data() + 44, 4)));
+
+  // assigning a slice of ourselves keeps the data alive
+  shared_buffer = shared_buffer.slice(396, 4);
+  ASSERT_EQ(shared_buffer.get_size(), 4);
+  ASSERT_EQ(shared_buffer.get_use_count(), 3);
+
+  EXPECT_THROW(slice.slice(4, 8), std::runtime_error);
+}
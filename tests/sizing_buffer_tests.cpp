@@ -0,0 +1,110 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "sizing_buffer.hpp"
+
+// an encode function that runs against any sink with the Buffer write API
+template <typename Sink>
+static void encode_message(Sink *sink, const std::vector<uint32_t> &values, size_t string_size)
+{
+  sink->write_uint8(1);
+  BufferSlot<uint32_t> slot = sink->template reserve_slot<uint32_t>();
+  size_t begin = sink->get_offset();
+
+  sink->write_string(std::string(string_size, 'x'));
+  sink->write_string8("abc");
+  sink->write_padded_string("abc", 16);
+  for (uint32_t value : values)
+  {
+    sink->write_varuint32(value);
+    sink->write_varint64(-(int64_t)value);
+  }
+
+  sink->write_varuint32_array(values.data(), values.size());
+  sink->write_array(values.data(), values.size());
+  sink->write_fields((uint16_t)1, 2.0, (int8_t)3);
+  sink->template write<float>(1.5f);
+  sink->template write_ordered<BUFFER_BYTE_ORDER_BIG>((uint64_t)4);
+  sink->patch(slot, (uint32_t)(sink->get_offset() - begin));
+}
+
+TEST(SizingBufferTests, exact_size)
+{
+  std::vector<uint32_t> values;
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    values.push_back(i * i * 31);
+  }
+
+  // the string sizes cover every size tag write_string picks
+  size_t string_sizes[] = { 1, 255, 256, 65535, 65536 };
+  for (size_t string_size : string_sizes)
+  {
+    SizingBuffer *sizing_buffer = new SizingBuffer();
+    encode_message(sizing_buffer, values, string_size);
+
+    // the real encode reserves once and never grows
+    Buffer *buffer = new Buffer();
+    buffer->reserve(sizing_buffer->get_size());
+    const uint8_t *data = buffer->get_data();
+    encode_message(buffer, values, string_size);
+
+    ASSERT_EQ(buffer->get_size(), sizing_buffer->get_size());
+    ASSERT_EQ(buffer->get_capacity(), sizing_buffer->get_size());
+    EXPECT_TRUE(buffer->get_data() == data);
+
+    delete sizing_buffer;
+    delete buffer;
+  }
+}
+
+TEST(SizingBufferTests, mark_and_rewind)
+{
+  SizingBuffer *sizing_buffer = new SizingBuffer();
+  sizing_buffer->write_uint32(1);
+
+  BufferMark mark = sizing_buffer->mark();
+  sizing_buffer->write_string("A quick brown fox jumps over the lazy dog.");
+  ASSERT_EQ(sizing_buffer->get_size(), 4 + 1 + 1 + 42);
+
+  sizing_buffer->rewind(mark);
+  ASSERT_EQ(sizing_buffer->get_size(), 4);
+
+  EXPECT_THROW(sizing_buffer->write_padded_string("abc", 2), std::runtime_error);
+
+  delete sizing_buffer;
+}
@@ -0,0 +1,375 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "stream.hpp"
+
+// reads everything written to the file back into a buffer
+static void read_file(FILE *file, Buffer *buffer)
+{
+  int fd = fileno(file);
+  lseek(fd, 0, SEEK_SET);
+
+  uint8_t data[4096];
+  ssize_t size = 0;
+  while ((size = read(fd, data, sizeof(data))) > 0)
+  {
+    buffer->write(data, size);
+  }
+}
+
+TEST(StreamTests, write_values)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+  StreamWriter *writer = new StreamWriter(fileno(file), 256);
+  for (uint32_t i = 0; i < 10000; i++)
+  {
+    writer->write_uint8(i & 0xff);
+    writer->write_uint32(i);
+    writer->write_float64(i * 0.5);
+    writer->write_string(str);
+  }
+
+  // memory use stays at a single block
+  EXPECT_TRUE(writer->get_capacity() == 256);
+  writer->flush();
+  EXPECT_TRUE(writer->get_size() == 0);
+
+  size_t flushed_size = writer->get_flushed_size();
+  delete writer;
+
+  Buffer *buffer = new Buffer();
+  read_file(file, buffer);
+  ASSERT_EQ(buffer->get_size(), flushed_size);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  for (uint32_t i = 0; i < 10000; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint8(), i & 0xff);
+    ASSERT_EQ(buffer_iterator->read_uint32(), i);
+    ASSERT_EQ(buffer_iterator->read_float64(), i * 0.5);
+    EXPECT_TRUE(buffer_iterator->read_string().compare(str) == 0);
+  }
+
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+  fclose(file);
+}
+
+TEST(StreamTests, write_large_payloads)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  std::string str(1000, 'x');
+  StreamWriter *writer = new StreamWriter(fileno(file), 64);
+  writer->write_uint16(1);
+  writer->write_string(str);
+  writer->pad(300);
+  writer->write_padded_string(str, 1200);
+  writer->write_uint16(2);
+  delete writer;
+
+  Buffer *buffer = new Buffer();
+  read_file(file, buffer);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint16(), 1);
+  EXPECT_TRUE(buffer_iterator->read_string().compare(str) == 0);
+  for (size_t i = 0; i < 300; i++)
+  {
+    ASSERT_EQ(buffer_iterator->read_uint8(), 0);
+  }
+
+  BufferView view = buffer_iterator->read_padded_string_view(1200);
+  EXPECT_TRUE(BufferView(view.get_data(), str.size()).compare(str));
+  ASSERT_EQ(view.get_data()[str.size()], 0);
+  ASSERT_EQ(buffer_iterator->read_uint16(), 2);
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+  fclose(file);
+}
+
+TEST(StreamTests, read_values)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+  std::string str1(1000, 'x');
+  StreamWriter *writer = new StreamWriter(fileno(file));
+  for (uint32_t i = 0; i < 10000; i++)
+  {
+    writer->write_uint8(i & 0xff);
+    writer->write_uint32(i);
+    writer->write_float64(i * 0.5);
+    writer->write_string(str);
+  }
+
+  writer->write_string(str1);
+  delete writer;
+
+  lseek(fileno(file), 0, SEEK_SET);
+
+  // a window of a few bytes makes almost every value straddle a refill
+  StreamReader *reader = new StreamReader(fileno(file), 7);
+  for (uint32_t i = 0; i < 10000; i++)
+  {
+    ASSERT_EQ(reader->read_uint8(), i & 0xff);
+    ASSERT_EQ(reader->read_uint32(), i);
+    ASSERT_EQ(reader->read_float64(), i * 0.5);
+    EXPECT_TRUE(reader->read_string().compare(str) == 0);
+  }
+
+  EXPECT_TRUE(reader->read_string().compare(str1) == 0);
+  EXPECT_TRUE(reader->is_eof());
+  EXPECT_THROW(reader->read_uint8(), std::runtime_error);
+
+  delete reader;
+  fclose(file);
+}
+
+TEST(StreamTests, read_position)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  StreamWriter *writer = new StreamWriter(fileno(file));
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    writer->write_uint32(i);
+  }
+
+  delete writer;
+
+  lseek(fileno(file), 0, SEEK_SET);
+
+  StreamReader *reader = new StreamReader(fileno(file), 64);
+  reader->skip_read(400);
+  ASSERT_EQ(reader->get_position(), 400);
+  ASSERT_EQ(reader->read_uint32(), 100);
+  ASSERT_EQ(reader->get_position(), 404);
+  EXPECT_TRUE(reader->get_window_size() == 400);
+
+  delete reader;
+  fclose(file);
+}
+
+TEST(StreamTests, try_read_partial)
+{
+  Buffer *buffer = new Buffer();
+  buffer->write_uint32(7);
+  buffer->write_string("A quick brown fox jumps over the lazy dog.");
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  ASSERT_EQ(fcntl(fds[0], F_SETFL, O_NONBLOCK), 0);
+
+  // only part of the frame has arrived, the string cannot be read yet
+  size_t size = 20;
+  ASSERT_EQ(write(fds[1], buffer->get_data(), size), (ssize_t)size);
+
+  StreamReader *reader = new StreamReader(fds[0], 8);
+  uint32_t value = 0;
+  std::string str;
+  EXPECT_TRUE(reader->try_read_uint32(value));
+  ASSERT_EQ(value, 7u);
+  EXPECT_FALSE(reader->try_read_string(str));
+  ASSERT_EQ(reader->get_position(), 4);
+  EXPECT_FALSE(reader->is_eof());
+
+  // the rest of the frame arrives
+  ASSERT_EQ(write(fds[1], buffer->get_data() + size, buffer->get_size() - size), (ssize_t)(buffer->get_size() - size));
+  EXPECT_TRUE(reader->try_read_string(str));
+  ASSERT_EQ(str, "A quick brown fox jumps over the lazy dog.");
+  uint8_t value1 = 0;
+  EXPECT_FALSE(reader->try_read_uint8(value1));
+
+  delete reader;
+  delete buffer;
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(StreamTests, prepare_and_commit)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  std::string str = "A quick brown fox jumps over the lazy dog.";
+  ASSERT_EQ(write(fds[1], str.c_str(), str.size()), (ssize_t)str.size());
+  close(fds[1]);
+
+  // forward the pipe to the file without an intermediate copy, preparing
+  // more than the block holds flushes what was written before
+  StreamWriter *writer = new StreamWriter(fileno(file), 16);
+  writer->write_uint32(7);
+
+  ssize_t size = 0;
+  while ((size = read(fds[0], writer->prepare(32), 32)) > 0)
+  {
+    writer->commit(size);
+  }
+
+  EXPECT_TRUE(writer->get_flushed_size() > 0);
+  delete writer;
+  close(fds[0]);
+
+  Buffer *buffer = new Buffer();
+  read_file(file, buffer);
+  ASSERT_EQ(buffer->get_size(), 4 + str.size());
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint32(), 7);
+  EXPECT_TRUE(buffer_iterator->read_view(str.size()).compare(str));
+
+  delete buffer_iterator;
+  delete buffer;
+  fclose(file);
+}
+
+TEST(StreamTests, write_ordered_array_bounded)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  std::vector<uint32_t> values(100000);
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    values[i] = (uint32_t)(i * 2654435761u);
+  }
+
+  // swapped arrays are converted a chunk at a time, the block never grows
+  StreamWriter *writer = new StreamWriter(fileno(file), 4096);
+  writer->write_uint8(1);
+  writer->write_ordered_array<BUFFER_BYTE_ORDER_BIG>(values.data(), values.size());
+  ASSERT_EQ(writer->get_capacity(), 4096);
+  delete writer;
+
+  Buffer *buffer = new Buffer();
+  read_file(file, buffer);
+  ASSERT_EQ(buffer->get_size(), 1 + values.size() * sizeof(uint32_t));
+
+  std::vector<uint32_t> decoded_values(values.size());
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint8(), 1);
+  buffer_iterator->read_ordered_array<BUFFER_BYTE_ORDER_BIG>(decoded_values.data(), decoded_values.size());
+  ASSERT_TRUE(decoded_values == values);
+
+  delete buffer_iterator;
+  delete buffer;
+  fclose(file);
+}
+
+TEST(StreamTests, write_varuint32_array_bounded)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  std::vector<uint32_t> values(100001);
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    values[i] = (uint32_t)(i * 2654435761u) >> (i % 32);
+  }
+
+  // the encoding is flushed a group at a time, the block never grows
+  StreamWriter *writer = new StreamWriter(fileno(file), 4096);
+  writer->write_uint8(1);
+  writer->write_varuint32_array(values.data(), values.size());
+  ASSERT_EQ(writer->get_capacity(), 4096);
+  delete writer;
+
+  Buffer *buffer = new Buffer();
+  read_file(file, buffer);
+  ASSERT_EQ(buffer->get_size(), 1 + get_stream_vbyte_size(values.data(), values.size()));
+
+  std::vector<uint32_t> decoded_values(values.size());
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint8(), 1);
+  buffer_iterator->read_varuint32_array(decoded_values.data(), decoded_values.size());
+  ASSERT_TRUE(decoded_values == values);
+
+  delete buffer_iterator;
+  delete buffer;
+  fclose(file);
+}
+
+TEST(StreamTests, mark_and_slot_after_flush)
+{
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file != nullptr);
+
+  StreamWriter *writer = new StreamWriter(fileno(file), 16);
+  BufferMark mark = writer->mark();
+  BufferSlot<uint32_t> slot = writer->reserve_slot<uint32_t>();
+  writer->write_uint64(1);
+
+  // the slot is still in the block, it can be patched
+  writer->patch(slot, 12u);
+
+  // flushing sends the slot and the marked bytes to the file
+  writer->write_uint64(2);
+  ASSERT_TRUE(writer->get_flushed_size() > 0);
+  EXPECT_THROW(writer->patch(slot, 13u), std::runtime_error);
+  EXPECT_THROW(writer->rewind(mark), std::runtime_error);
+  delete writer;
+
+  Buffer *buffer = new Buffer();
+  read_file(file, buffer);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint32(), 12);
+  ASSERT_EQ(buffer_iterator->read_uint64(), 1);
+  ASSERT_EQ(buffer_iterator->read_uint64(), 2);
+
+  delete buffer_iterator;
+  delete buffer;
+  fclose(file);
+}
@@ -0,0 +1,200 @@
+// Copyright (c) 2019, Pictofeed, LLC.
+//
+// This file is part of SerialBuf.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// You should have received a copy of the MIT License
+// along with SerialBuf. If not, see <https://opensource.org/licenses/MIT>.
+
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "varint.hpp"
+#include "buffer.hpp"
+
+TEST(VarintTests, zigzag)
+{
+  ASSERT_EQ(zigzag_encode32(0), 0u);
+  ASSERT_EQ(zigzag_encode32(-1), 1u);
+  ASSERT_EQ(zigzag_encode32(1), 2u);
+  ASSERT_EQ(zigzag_encode32(std::numeric_limits<int32_t>::min()), std::numeric_limits<uint32_t>::max());
+  ASSERT_EQ(zigzag_decode32(std::numeric_limits<uint32_t>::max()), std::numeric_limits<int32_t>::min());
+  ASSERT_EQ(zigzag_decode32(zigzag_encode32(std::numeric_limits<int32_t>::max())), std::numeric_limits<int32_t>::max());
+
+  ASSERT_EQ(zigzag_encode64(-2), 3u);
+  ASSERT_EQ(zigzag_decode64(zigzag_encode64(std::numeric_limits<int64_t>::min())), std::numeric_limits<int64_t>::min());
+  ASSERT_EQ(zigzag_decode64(zigzag_encode64(std::numeric_limits<int64_t>::max())), std::numeric_limits<int64_t>::max());
+}
+
+TEST(VarintTests, varuint_size)
+{
+  ASSERT_EQ(get_varuint_size(0), 1);
+  ASSERT_EQ(get_varuint_size(127), 1);
+  ASSERT_EQ(get_varuint_size(128), 2);
+  ASSERT_EQ(get_varuint_size(std::numeric_limits<uint32_t>::max()), VARINT_MAX_SIZE32);
+  ASSERT_EQ(get_varuint_size(std::numeric_limits<uint64_t>::max()), VARINT_MAX_SIZE64);
+}
+
+TEST(VarintTests, write_varuint)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->write_varuint32(0);
+  buffer->write_varuint32(300);
+  buffer->write_varuint32(std::numeric_limits<uint32_t>::max());
+  buffer->write_varuint64(std::numeric_limits<uint64_t>::max());
+  ASSERT_EQ(buffer->get_size(), 1 + 2 + VARINT_MAX_SIZE32 + VARINT_MAX_SIZE64);
+
+  // 300 is 0b10_0101100
+  ASSERT_EQ(buffer->get_data()[1], 0xac);
+  ASSERT_EQ(buffer->get_data()[2], 0x02);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_varuint32(), 0u);
+  ASSERT_EQ(buffer_iterator->read_varuint32(), 300u);
+  ASSERT_EQ(buffer_iterator->read_varuint32(), std::numeric_limits<uint32_t>::max());
+  ASSERT_EQ(buffer_iterator->read_varuint64(), std::numeric_limits<uint64_t>::max());
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(VarintTests, write_varint)
+{
+  Buffer *buffer = new Buffer();
+
+  buffer->write_varint32(-1);
+  buffer->write_varint32(std::numeric_limits<int32_t>::min());
+  buffer->write_varint64(-1000);
+  buffer->write_varint64(std::numeric_limits<int64_t>::max());
+  ASSERT_EQ(buffer->get_data()[0], 1);
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_varint32(), -1);
+  ASSERT_EQ(buffer_iterator->read_varint32(), std::numeric_limits<int32_t>::min());
+  ASSERT_EQ(buffer_iterator->read_varint64(), -1000);
+  ASSERT_EQ(buffer_iterator->read_varint64(), std::numeric_limits<int64_t>::max());
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(VarintTests, read_invalid_varuint)
+{
+  Buffer *buffer = new Buffer();
+
+  // truncated
+  buffer->write_uint8(0x80);
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  EXPECT_THROW(buffer_iterator->read_varuint32(), std::runtime_error);
+  ASSERT_EQ(buffer_iterator->get_offset(), 0);
+
+  // too long for 32 bits
+  buffer->write_varuint64((uint64_t)std::numeric_limits<uint32_t>::max() + 1);
+  buffer_iterator->set_offset(1);
+  EXPECT_THROW(buffer_iterator->read_varuint32(), std::runtime_error);
+
+  // too long for 64 bits, the tenth byte holds more than the top bit
+  buffer->clear();
+  for (size_t i = 0; i < 9; i++)
+  {
+    buffer->write_uint8(0xff);
+  }
+
+  buffer->write_uint8(0x7f);
+  buffer_iterator->set_offset(0);
+  EXPECT_THROW(buffer_iterator->read_varuint64(), std::runtime_error);
+  ASSERT_EQ(buffer_iterator->get_offset(), 0);
+
+  // the largest value still reads
+  buffer->clear();
+  buffer->write_varuint64(std::numeric_limits<uint64_t>::max());
+  ASSERT_EQ(buffer->get_size(), 10);
+  buffer_iterator->set_offset(0);
+  ASSERT_EQ(buffer_iterator->read_varuint64(), std::numeric_limits<uint64_t>::max());
+
+  delete buffer;
+  delete buffer_iterator;
+}
+
+TEST(VarintTests, stream_vbyte)
+{
+  for (size_t count = 0; count < 200; count += 7)
+  {
+    std::vector<uint32_t> values;
+    for (size_t i = 0; i < count; i++)
+    {
+      // a mix of one to four byte values
+      values.push_back((uint32_t)((i * 2654435761u) >> ((i % 4) * 8)));
+    }
+
+    std::vector<uint8_t> data(get_stream_vbyte_size(values.data(), count));
+    ASSERT_EQ(stream_vbyte_encode(data.data(), values.data(), count), data.size());
+
+    std::vector<uint32_t> decoded_values(count);
+    ASSERT_EQ(stream_vbyte_decode(decoded_values.data(), data.data(), count), data.size());
+    EXPECT_TRUE(decoded_values == values);
+  }
+}
+
+TEST(VarintTests, write_varuint32_array)
+{
+  Buffer *buffer = new Buffer();
+
+  std::vector<uint32_t> values;
+  for (uint32_t i = 0; i < 10000; i++)
+  {
+    values.push_back(i % 3 == 0 ? i : i * 100003);
+  }
+
+  buffer->write_uint8(1);
+  buffer->write_varuint32_array(values.data(), values.size());
+  buffer->write_uint8(2);
+  EXPECT_TRUE(buffer->get_size() < values.size() * sizeof(uint32_t));
+
+  BufferIterator *buffer_iterator = new BufferIterator(buffer);
+  ASSERT_EQ(buffer_iterator->read_uint8(), 1);
+
+  std::vector<uint32_t> read_values(values.size());
+  buffer_iterator->read_varuint32_array(read_values.data(), read_values.size());
+  EXPECT_TRUE(read_values == values);
+  ASSERT_EQ(buffer_iterator->read_uint8(), 2);
+  EXPECT_TRUE(buffer_iterator->get_remaining_size() == 0);
+
+  // a truncated array is rejected before anything is decoded
+  buffer->set_size(buffer->get_size() - 2);
+  buffer_iterator->set_offset(1);
+  EXPECT_THROW(buffer_iterator->read_varuint32_array(read_values.data(), read_values.size()), std::runtime_error);
+  ASSERT_EQ(buffer_iterator->get_offset(), 1);
+
+  delete buffer;
+  delete buffer_iterator;
+}